@@ -0,0 +1,764 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <cxxopts/cxxopts.hpp>
+#include <json/json.hpp>
+
+#include "CompressedSeries.hpp"
+#include "DateTime.hpp"
+#include "HistoryAnalyzer.hpp"
+#include "HistoryIndex.hpp"
+#include "HistoryParser.hpp"
+#include "HistorySourceBinary.hpp"
+#include "HistorySourceFile.hpp"
+#include "HistorySourceHTTP.hpp"
+#include "HTTPConnectionPool.hpp"
+#include "MappedFile.hpp"
+#include "MockHistoryServer.hpp"
+#include "Parallel.hpp"
+#include "Selection.hpp"
+
+namespace
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // Collects results for the JSON report, alongside the text output
+    ////////////////////////////////////////////////////////////////////////////
+    class Report
+    {
+        public:
+        // Record a timing, with any other figures worth tracking
+        void add(const std::string& bench, const std::string& name, std::size_t points, double seconds,
+            nlohmann::json extra = nlohmann::json::object())
+        {
+            extra["bench"] = bench;
+            extra["name"] = name;
+            extra["points"] = points;
+            extra["seconds"] = seconds;
+            if (points && seconds > 0.)
+            {
+                extra["pointsPerSecond"] = points / seconds;
+            }
+            m_results.push_back(std::move(extra));
+        }
+
+        // Write everything recorded, with what's needed to compare runs
+        bool write(const std::string& path, const nlohmann::json& options) const
+        {
+            nlohmann::json report =
+            {
+                {"time", DateTime::format(static_cast<std::int64_t>(std::time(nullptr)))},
+                {"hardwareThreads", std::thread::hardware_concurrency()},
+                {"options", options},
+                {"results", m_results}
+            };
+
+            std::ofstream file(path, std::ios::trunc);
+            file << std::setw(2) << report << std::endl;
+            if (!file)
+            {
+                std::cout << "Failed to write report to " << path << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        private:
+        nlohmann::json m_results = nlohmann::json::array();
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Write a synthetic minute granularity history of the given number of
+    // points, or roughly the given number of bytes, whichever comes first.
+    // Returns the number of points written
+    ////////////////////////////////////////////////////////////////////////////
+    std::size_t writeHistory(std::ostream& out, std::size_t points,
+        std::size_t bytes = std::numeric_limits<std::size_t>::max())
+    {
+        std::mt19937_64 random(42);
+        std::normal_distribution<double> change(0., 5.);
+
+        out << "{\"bpi\":{";
+
+        std::size_t written = 0;
+        std::size_t count = 0;
+        double price = 10000.;
+        char line[64];
+        char date[DateTime::MaxLength + 1] = {};
+
+        // Start at 2010-01-01 00:01
+        for (std::int64_t time = 1262304060; count < points && written < bytes; time += 60)
+        {
+            date[DateTime::format(time, date)] = '\0';
+            price = std::max(1., price + change(random));
+            auto length = std::sprintf(line, "%s\"%s\":%.4f", count ? "," : "", date, price);
+            out.write(line, length);
+            written += static_cast<std::size_t>(length);
+            ++count;
+        }
+
+        out << "},\"disclaimer\":\"Synthetic data generated by bcbench\"}";
+        return count;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Write a synthetic history file of roughly the given size, returning the
+    // number of points written
+    ////////////////////////////////////////////////////////////////////////////
+    std::size_t writeHistoryFile(const std::string& path, std::size_t bytes)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        return writeHistory(file, std::numeric_limits<std::size_t>::max(), bytes);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Synthetic history json text with the given number of points
+    ////////////////////////////////////////////////////////////////////////////
+    std::string generateHistory(std::size_t points)
+    {
+        std::ostringstream text;
+        writeHistory(text, points);
+        return text.str();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Generate a random walk of prices
+    ////////////////////////////////////////////////////////////////////////////
+    std::vector<double> generatePrices(std::size_t count)
+    {
+        std::mt19937_64 random(42);
+        std::normal_distribution<double> change(0., 5.);
+
+        std::vector<double> prices(count);
+        double price = 10000.;
+        for (auto& p : prices)
+        {
+            price = std::max(1., price + change(random));
+            p = price;
+        }
+        return prices;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Split a comma separated list
+    ////////////////////////////////////////////////////////////////////////////
+    std::vector<std::string> split(const std::string& list)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            if (!item.empty())
+            {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Time a function, returning the wall time in seconds
+    ////////////////////////////////////////////////////////////////////////////
+    template<class Function>
+    double time(Function&& function)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Parsing a synthetic history file, streamed through ifstream versus
+    // memory mapped
+    ////////////////////////////////////////////////////////////////////////////
+    void benchFile(const std::string& path, std::size_t bytes, bool keep, Report& report)
+    {
+        std::cout << "Writing " << bytes / (1024 * 1024) << "MB of history to " << path << std::endl;
+        auto points = writeHistoryFile(path, bytes);
+        std::cout << points << " data points" << std::endl;
+
+        // Raw parse throughput
+        std::size_t parsed = 0;
+        auto count = [&parsed](std::string_view, double)
+        {
+            ++parsed;
+        };
+
+        auto seconds = time([&]
+        {
+            std::ifstream file(path, std::ios::binary);
+            HistoryParser::parse(file, count);
+        });
+        std::cout << "HistoryParser::parse (ifstream): " << seconds << "s, "
+            << bytes / seconds / (1024 * 1024) << "MB/s" << std::endl;
+        report.add("file", "HistoryParser::parse (ifstream)", points, seconds, {{"bytes", bytes}});
+
+        seconds = time([&]
+        {
+            MappedFile file(path);
+            HistoryParser::parse(file.data(), file.size(), count);
+        });
+        std::cout << "HistoryParser::parse (mmap): " << seconds << "s, "
+            << bytes / seconds / (1024 * 1024) << "MB/s" << std::endl;
+        report.add("file", "HistoryParser::parse (mmap)", points, seconds, {{"bytes", bytes}});
+
+        // File source into the analyzer
+        for (auto mode : {HistorySourceFile::Mode::Stream, HistorySourceFile::Mode::MemoryMap})
+        {
+            HistorySourceFile source(path, mode);
+            auto name = mode == HistorySourceFile::Mode::Stream ? "ifstream" : "mmap";
+
+            HistoryAnalyzer analyzer;
+            seconds = time([&]
+            {
+                source.read(analyzer);
+            });
+
+            std::cout << "HistorySourceFile::read (" << name << "): " << seconds << "s, "
+                << bytes / seconds / (1024 * 1024) << "MB/s" << std::endl;
+            report.add("file", std::string("HistorySourceFile::read (") + name + ")", points, seconds,
+                {{"bytes", bytes}});
+        }
+
+        // The same history through the binary format
+        auto binaryPath = path + ".bin";
+        {
+            HistoryAnalyzer analyzer;
+            HistorySourceFile(path, HistorySourceFile::Mode::MemoryMap).read(analyzer);
+            seconds = time([&]
+            {
+                HistorySourceBinary::write(binaryPath, analyzer);
+            });
+            std::cout << "HistorySourceBinary::write: " << seconds << "s" << std::endl;
+            report.add("file", "HistorySourceBinary::write", points, seconds);
+        }
+
+        HistoryAnalyzer binary;
+        seconds = time([&]
+        {
+            HistorySourceBinary(binaryPath).read(binary);
+        });
+        std::cout << "HistorySourceBinary::read: " << seconds << "s, "
+            << binary.size() / seconds / 1e6 << "M points/s" << std::endl;
+        report.add("file", "HistorySourceBinary::read", binary.size(), seconds);
+
+        if (!keep)
+        {
+            std::remove(binaryPath.c_str());
+        }
+
+        if (!keep)
+        {
+            std::remove(path.c_str());
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Parsing history json held in memory, through a json document versus
+    // straight from the text. Documents take many times the memory of the
+    // text, so they're skipped above maxDocumentPoints
+    ////////////////////////////////////////////////////////////////////////////
+    void benchParse(std::size_t points, std::size_t maxDocumentPoints, Report& report)
+    {
+        auto text = generateHistory(points);
+        std::cout << "Parse " << points << " points (" << text.size() / (1024 * 1024) << "MB):";
+
+        HistoryAnalyzer analyzer;
+        auto seconds = time([&]
+        {
+            analyzer.parse(text.data(), text.size());
+        });
+        std::cout << " text " << seconds << "s";
+        report.add("parse", "HistoryAnalyzer::parse (text)", points, seconds, {{"bytes", text.size()}});
+
+        seconds = time([&]
+        {
+            std::istringstream stream(text);
+            analyzer.parse(stream);
+        });
+        std::cout << ", stream " << seconds << "s";
+        report.add("parse", "HistoryAnalyzer::parse (stream)", points, seconds, {{"bytes", text.size()}});
+
+        if (points <= maxDocumentPoints)
+        {
+            nlohmann::json json;
+            auto documentSeconds = time([&]
+            {
+                json = nlohmann::json::parse(text);
+            });
+            seconds = time([&]
+            {
+                analyzer.parse(json);
+            });
+            std::cout << ", json document " << documentSeconds << "s + " << seconds << "s";
+            report.add("parse", "nlohmann::json::parse", points, documentSeconds, {{"bytes", text.size()}});
+            report.add("parse", "HistoryAnalyzer::parse (json)", points, seconds);
+        }
+        std::cout << std::endl;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Getting history through the file and HTTP sources, the HTTP source
+    // against a mock server on the loopback interface
+    ////////////////////////////////////////////////////////////////////////////
+    void benchSource(std::size_t points, const std::string& path, std::size_t maxDocumentPoints, Report& report)
+    {
+        MockHistoryServer::Options options;
+        options.points = points;
+        options.start = 1262304060;
+        options.interval = 60;
+        MockHistoryServer server(options);
+        auto port = server.start();
+
+        // Read the same text from the file as is served
+        auto& text = server.history();
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << text;
+        }
+
+        HistorySourceFile file(path, HistorySourceFile::Mode::MemoryMap);
+        HistorySourceHTTP http("127.0.0.1", MockHistoryServer::Path, port);
+
+        std::vector<std::pair<std::string, const HistorySource*>> sources =
+        {
+            {"HistorySourceFile", &file},
+            {"HistorySourceHTTP", &http}
+        };
+
+        std::cout << "Sources for " << points << " points:";
+        for (auto& source : sources)
+        {
+            HistoryAnalyzer analyzer;
+            auto seconds = time([&]
+            {
+                source.second->read(analyzer);
+            });
+            std::cout << " " << source.first << "::read " << seconds << "s";
+            report.add("source", source.first + "::read", points, seconds, {{"bytes", text.size()}});
+
+            if (points <= maxDocumentPoints)
+            {
+                seconds = time([&]
+                {
+                    source.second->get();
+                });
+                std::cout << ", ::get " << seconds << "s";
+                report.add("source", source.first + "::get", points, seconds, {{"bytes", text.size()}});
+            }
+            std::cout << ";";
+        }
+        std::cout << std::endl;
+
+        server.stop();
+        std::remove(path.c_str());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Fetch throughput with several clients at once, against a mock server
+    // that takes the given latency to answer each request
+    ////////////////////////////////////////////////////////////////////////////
+    void benchFetch(const std::vector<std::string>& clientCounts, std::size_t requests,
+        std::chrono::milliseconds latency, Report& report)
+    {
+        std::size_t most = 1;
+        for (auto& clients : clientCounts)
+        {
+            most = std::max<std::size_t>(most, std::stoull(clients));
+        }
+
+        // Enough server threads that only the clients limit concurrency
+        MockHistoryServer::Options options;
+        options.points = 1000;
+        options.latency = latency;
+        options.threads = most;
+        MockHistoryServer server(options);
+        auto port = server.start();
+
+        for (auto& count : clientCounts)
+        {
+            auto clients = std::stoull(count);
+            std::atomic<std::size_t> failed{0};
+            HTTPConnectionPool pool;
+
+            auto seconds = time([&]
+            {
+                std::vector<std::thread> threads;
+                for (std::size_t c = 0; c < clients; ++c)
+                {
+                    threads.emplace_back([&]
+                    {
+                        HistorySourceHTTP source("127.0.0.1", MockHistoryServer::Path, port, pool);
+                        HistoryAnalyzer analyzer;
+                        for (std::size_t r = 0; r < requests; ++r)
+                        {
+                            failed += !source.read(analyzer);
+                        }
+                    });
+                }
+                for (auto& thread : threads)
+                {
+                    thread.join();
+                }
+            });
+
+            auto total = clients * requests;
+            std::cout << "Fetch with " << clients << " clients, " << latency.count() << "ms latency: "
+                << total / seconds << " requests/s, " << pool.connectionsOpened() << " connections"
+                << (failed ? " FAILURES" : "") << std::endl;
+            report.add("fetch", "HistorySourceHTTP::read", total * options.points, seconds,
+                {{"clients", clients}, {"requests", total}, {"requestsPerSecond", total / seconds},
+                {"latencyMs", latency.count()}, {"failed", failed.load()}});
+        }
+
+        server.stop();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Finding the median with a full sort versus selection
+    ////////////////////////////////////////////////////////////////////////////
+    void benchMedian(std::size_t points, Report& report)
+    {
+        auto prices = generatePrices(points);
+        double sorted = 0., selected = 0.;
+
+        auto sortSeconds = time([&]
+        {
+            std::vector<double> copy(prices);
+            std::sort(copy.begin(), copy.end());
+            sorted = points % 2 ? copy[points / 2] : (copy[points / 2 - 1] + copy[points / 2]) / 2;
+        });
+
+        auto selectSeconds = time([&]
+        {
+            std::vector<double> copy(prices);
+            selected = Selection::median(copy.data(), copy.size());
+        });
+
+        std::cout << "Median of " << points << " points: sort " << sortSeconds << "s, select "
+            << selectSeconds << "s (" << sortSeconds / selectSeconds << "x)"
+            << (sorted == selected ? "" : " MISMATCH") << std::endl;
+        report.add("median", "sort", points, sortSeconds);
+        report.add("median", "Selection::median", points, selectSeconds, {{"matches", sorted == selected}});
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Analyzing a series on one thread versus several
+    ////////////////////////////////////////////////////////////////////////////
+    void benchAnalyze(std::size_t points, unsigned threads, Report& report)
+    {
+        auto prices = generatePrices(points);
+
+        HistoryAnalyzer single;
+        for (std::size_t i = 0; i < points; ++i)
+        {
+            single.append(1262304060 + static_cast<std::int64_t>(i) * 60, prices[i]);
+        }
+
+        // A separate copy, as analysis is kept between calls
+        HistoryAnalyzer parallel;
+        parallel.assign(single.getTimes(), single.getPrices());
+        parallel.setThreadCount(threads);
+
+        auto singleSeconds = time([&]
+        {
+            single.analyze();
+        });
+
+        auto parallelSeconds = time([&]
+        {
+            parallel.analyze();
+        });
+
+        auto repeatSeconds = time([&]
+        {
+            single.analyze();
+        });
+
+        std::cout << "Analyze " << points << " points: 1 thread " << singleSeconds << "s, "
+            << Parallel::threadCount(threads) << " threads " << parallelSeconds << "s ("
+            << singleSeconds / parallelSeconds << "x), repeated " << repeatSeconds << "s" << std::endl;
+        report.add("analyze", "HistoryAnalyzer::analyze", points, singleSeconds, {{"threads", 1}});
+        report.add("analyze", "HistoryAnalyzer::analyze", points, parallelSeconds,
+            {{"threads", Parallel::threadCount(threads)}});
+        report.add("analyze", "HistoryAnalyzer::analyze (repeated)", points, repeatSeconds);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Medians of random date ranges, copying and selecting each range versus
+    // querying an index built once
+    ////////////////////////////////////////////////////////////////////////////
+    void benchRange(std::size_t points, std::size_t queries, Report& report)
+    {
+        auto prices = generatePrices(points);
+
+        HistoryAnalyzer analyzer;
+        for (std::size_t i = 0; i < points; ++i)
+        {
+            analyzer.append(1262304060 + static_cast<std::int64_t>(i) * 60, prices[i]);
+        }
+
+        std::mt19937_64 random(42);
+        std::uniform_int_distribution<std::size_t> position(0, points - 1);
+        std::vector<std::pair<std::size_t, std::size_t>> ranges(queries);
+        for (auto& range : ranges)
+        {
+            auto a = position(random), b = position(random);
+            range = {std::min(a, b), std::max(a, b) + 1};
+        }
+
+        std::vector<double> selected(queries), indexed(queries);
+        auto selectSeconds = time([&]
+        {
+            for (std::size_t i = 0; i < queries; ++i)
+            {
+                std::vector<double> copy(prices.begin() + ranges[i].first, prices.begin() + ranges[i].second);
+                selected[i] = Selection::median(copy.data(), copy.size());
+            }
+        });
+
+        std::unique_ptr<HistoryIndex> index;
+        auto buildSeconds = time([&]
+        {
+            index = std::make_unique<HistoryIndex>(analyzer);
+        });
+
+        auto indexSeconds = time([&]
+        {
+            for (std::size_t i = 0; i < queries; ++i)
+            {
+                indexed[i] = index->median(ranges[i].first, ranges[i].second);
+            }
+        });
+
+        std::cout << queries << " range medians of " << points << " points: select " << selectSeconds
+            << "s, index " << indexSeconds << "s (" << selectSeconds / indexSeconds << "x) + build "
+            << buildSeconds << "s" << (selected == indexed ? "" : " MISMATCH") << std::endl;
+        report.add("range", "Selection::median", points, selectSeconds, {{"queries", queries}});
+        report.add("range", "HistoryIndex::median", points, indexSeconds,
+            {{"queries", queries}, {"matches", selected == indexed}});
+        report.add("range", "HistoryIndex build", points, buildSeconds);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size and load time of the history in each file encoding
+    ////////////////////////////////////////////////////////////////////////////
+    void benchFormats(std::size_t points, const std::string& path, Report& report)
+    {
+        auto prices = generatePrices(points);
+        HistoryAnalyzer analyzer;
+        for (std::size_t i = 0; i < points; ++i)
+        {
+            analyzer.append(1262304060 + static_cast<std::int64_t>(i) * 60, prices[i]);
+        }
+
+        for (auto name : {"json", "cbor", "msgpack", "ubjson"})
+        {
+            HistorySourceFile::Format format;
+            HistorySourceFile::parseFormat(name, format);
+            auto file = path + "." + name;
+            HistorySourceFile::write(file, analyzer, format);
+
+            HistoryAnalyzer loaded;
+            auto seconds = time([&]
+            {
+                HistorySourceFile(file, HistorySourceFile::Mode::MemoryMap, format).read(loaded);
+            });
+
+            auto bytes = MappedFile(file).size();
+            std::cout << points << " points as " << name << ": " << bytes / (1024 * 1024)
+                << "MB, read " << seconds << "s" << std::endl;
+            report.add("formats", std::string("HistorySourceFile::read (") + name + ")", points, seconds,
+                {{"bytes", bytes}});
+            std::remove(file.c_str());
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Memory and analyze time of a compressed series versus the analyzer
+    ////////////////////////////////////////////////////////////////////////////
+    void benchCompress(std::size_t points, Report& report)
+    {
+        // Prices to four places, as they come from the API
+        auto prices = generatePrices(points);
+        HistoryAnalyzer analyzer;
+        for (std::size_t i = 0; i < points; ++i)
+        {
+            analyzer.append(1262304060 + static_cast<std::int64_t>(i) * 60, std::round(prices[i] * 10000.) / 10000.);
+        }
+
+        std::unique_ptr<CompressedSeries> series;
+        auto compressSeconds = time([&]
+        {
+            series = std::make_unique<CompressedSeries>(analyzer);
+        });
+
+        HistoryAnalyzer::Stats expected, stats;
+        auto analyzeSeconds = time([&]
+        {
+            expected = analyzer.analyze();
+        });
+        auto compressedSeconds = time([&]
+        {
+            stats = series->analyze();
+        });
+
+        auto raw = points * (sizeof(std::int64_t) + sizeof(double));
+        std::cout << "Compress " << points << " points: " << raw / (1024 * 1024) << "MB to "
+            << series->memoryUsage() / (1024 * 1024) << "MB (" << series->memoryUsage() * 8. / points
+            << " bits/point) in " << compressSeconds << "s, analyze " << analyzeSeconds << "s, compressed "
+            << compressedSeconds << "s" << (stats.medianPrice == expected.medianPrice ? "" : " MISMATCH")
+            << std::endl;
+        report.add("compress", "CompressedSeries build", points, compressSeconds,
+            {{"bytes", series->memoryUsage()}, {"rawBytes", raw}});
+        report.add("compress", "HistoryAnalyzer::analyze", points, analyzeSeconds);
+        report.add("compress", "CompressedSeries::analyze", points, compressedSeconds,
+            {{"matches", stats.medianPrice == expected.medianPrice}});
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    cxxopts::Options options(argv[0], "Benchmarks for bcstats");
+
+    options
+    .add_options()
+    ("h,help", "Show this help")
+    ("s,size", "Size of the synthetic history file in MB", cxxopts::value<std::size_t>()->default_value("1024"))
+    ("p,path", "Where to write the synthetic history file", cxxopts::value<std::string>()->default_value("bcbench.json"))
+    ("k,keep", "Keep the synthetic history file afterwards")
+    ("b,bench", "Comma separated benchmarks to run (file,parse,source,fetch,median,analyze,range,formats,compress)", cxxopts::value<std::string>()->default_value("file,parse,source,fetch,median,analyze,range"))
+    ("t,threads", "Threads for parallel benchmarks, 0 for one per core", cxxopts::value<unsigned>()->default_value("0"))
+    ("n,points", "Comma separated point counts for in-memory benchmarks", cxxopts::value<std::string>()->default_value("1000,1000000,10000000,100000000"))
+    ("d,max-document", "Most points to build a json document for, as documents need several times the memory of the text", cxxopts::value<std::size_t>()->default_value("10000000"))
+    ("q,queries", "Number of range queries for the range benchmark", cxxopts::value<std::size_t>()->default_value("1000"))
+    ("c,clients", "Comma separated numbers of concurrent clients for the fetch benchmark", cxxopts::value<std::string>()->default_value("1,4,16,64"))
+    ("r,requests", "Requests each client makes in the fetch benchmark", cxxopts::value<std::size_t>()->default_value("20"))
+    ("l,latency", "Milliseconds the mock server takes to answer in the fetch benchmark", cxxopts::value<unsigned>()->default_value("5"))
+    ("j,json", "Also write the results as JSON to this file, for comparing runs", cxxopts::value<std::string>());
+
+    try
+    {
+        auto result = options.parse(argc, argv);
+        if (result.count("help"))
+        {
+            std::cout << options.help();
+            return 0;
+        }
+
+        auto benches = split(result["bench"].as<std::string>());
+        auto runs = [&benches](const std::string& name)
+        {
+            return std::find(benches.begin(), benches.end(), name) != benches.end();
+        };
+
+        Report report;
+        auto& path = result["path"].as<std::string>();
+        auto maxDocument = result["max-document"].as<std::size_t>();
+
+        if (runs("file"))
+        {
+            benchFile(path, result["size"].as<std::size_t>() * 1024 * 1024, result.count("keep") > 0, report);
+        }
+
+        if (runs("fetch"))
+        {
+            benchFetch(split(result["clients"].as<std::string>()), result["requests"].as<std::size_t>(),
+                std::chrono::milliseconds(result["latency"].as<unsigned>()), report);
+        }
+
+        for (auto& points : split(result["points"].as<std::string>()))
+        {
+            if (runs("parse"))
+            {
+                benchParse(std::stoull(points), maxDocument, report);
+            }
+            if (runs("source"))
+            {
+                benchSource(std::stoull(points), path + ".source", maxDocument, report);
+            }
+            if (runs("median"))
+            {
+                benchMedian(std::stoull(points), report);
+            }
+            if (runs("analyze"))
+            {
+                benchAnalyze(std::stoull(points), result["threads"].as<unsigned>(), report);
+            }
+            if (runs("formats"))
+            {
+                benchFormats(std::stoull(points), path, report);
+            }
+            if (runs("range"))
+            {
+                benchRange(std::stoull(points), result["queries"].as<std::size_t>(), report);
+            }
+            if (runs("compress"))
+            {
+                benchCompress(std::stoull(points), report);
+            }
+        }
+
+        if (result.count("json"))
+        {
+            nlohmann::json settings =
+            {
+                {"bench", benches},
+                {"points", result["points"].as<std::string>()},
+                {"size", result["size"].as<std::size_t>()},
+                {"threads", result["threads"].as<unsigned>()},
+                {"queries", result["queries"].as<std::size_t>()},
+                {"clients", result["clients"].as<std::string>()},
+                {"requests", result["requests"].as<std::size_t>()},
+                {"latency", result["latency"].as<unsigned>()}
+            };
+            if (!report.write(result["json"].as<std::string>(), settings))
+            {
+                return 1;
+            }
+        }
+    }
+    catch(cxxopts::OptionException& e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -45,6 +45,7 @@ typedef SOCKET socket_t;
 #include <netdb.h>
 #include <cstring>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include <sys/socket.h>
@@ -54,6 +55,9 @@ typedef int socket_t;
 #define INVALID_SOCKET (-1)
 #endif
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <map>
@@ -62,6 +66,7 @@ typedef int socket_t;
 #include <regex>
 #include <string>
 #include <thread>
+#include <vector>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <assert.h>
@@ -79,6 +84,8 @@ typedef int socket_t;
  */
 #define CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND 5
 #define CPPHTTPLIB_KEEPALIVE_TIMEOUT_USECOND 0
+#define CPPHTTPLIB_THREAD_POOL_COUNT ((std::max)(8u, std::thread::hardware_concurrency() * 2))
+#define CPPHTTPLIB_THREAD_POOL_MAX_QUEUED 128
 
 namespace httplib
 {
@@ -96,6 +103,8 @@ struct ci {
     }
 };
 
+class ThreadPool;
+
 } // namespace detail
 
 enum class HttpVersion { v1_0 = 0, v1_1 };
@@ -209,6 +218,12 @@ public:
 
     void set_keep_alive_max_count(size_t count);
 
+    // Connections are handled by a fixed number of threads. Once they're all
+    // busy, up to max_queued more connections wait for one, then accepting
+    // waits too. Takes effect the next time the server listens
+    void set_thread_pool(size_t count, size_t max_queued);
+
+    int bind_to_port(const char* host, int port, int socket_flags = 0);
     int bind_to_any_port(const char* host, int socket_flags = 0);
     bool listen_after_bind();
 
@@ -220,6 +235,10 @@ public:
 protected:
     bool process_request(Stream& strm, bool last_connection, bool& connection_close);
 
+    // Whether an idle kept alive connection should close, as others are
+    // waiting for a thread or the server is stopping
+    bool yield_connection() const;
+
     size_t keep_alive_max_count_;
 
 private:
@@ -249,9 +268,9 @@ private:
     Handler     error_handler_;
     Logger      logger_;
 
-    // TODO: Use thread pool...
-    std::mutex  running_threads_mutex_;
-    int         running_threads_;
+    size_t      thread_pool_count_;
+    size_t      thread_pool_max_queued_;
+    std::unique_ptr<detail::ThreadPool> thread_pool_;
 };
 
 class Client {
@@ -496,17 +515,41 @@ inline bool wait_until_socket_is_ready(socket_t sock, size_t sec, size_t usec)
     return true;
 }
 
+// Wait for the next request on a kept alive connection. Gives up early if
+// an idle connection should yield, freeing its thread for others
+inline bool wait_for_request(socket_t sock, const std::function<bool()>& yield)
+{
+    if (!yield) {
+        return select_read(sock,
+            CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND,
+            CPPHTTPLIB_KEEPALIVE_TIMEOUT_USECOND) > 0;
+    }
+
+    const long slice = 100000;
+    long remaining = CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND * 1000000L + CPPHTTPLIB_KEEPALIVE_TIMEOUT_USECOND;
+    for (;;) {
+        auto wait = (std::min)(remaining, slice);
+        if (select_read(sock, 0, wait) > 0) {
+            return true;
+        }
+        remaining -= wait;
+        if (remaining <= 0 || yield()) {
+            return false;
+        }
+    }
+}
+
 template <typename T>
-inline bool read_and_close_socket(socket_t sock, size_t keep_alive_max_count, T callback)
+inline bool read_and_close_socket(socket_t sock, size_t keep_alive_max_count, T callback,
+    const std::function<bool()>& yield = nullptr)
 {
     bool ret = false;
 
     if (keep_alive_max_count > 0) {
         auto count = keep_alive_max_count;
+        // The first request is always waited for in full
         while (count > 0 &&
-               detail::select_read(sock,
-                   CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND,
-                   CPPHTTPLIB_KEEPALIVE_TIMEOUT_USECOND) > 0) {
+               detail::wait_for_request(sock, count < keep_alive_max_count ? yield : nullptr)) {
             SocketStream strm(sock);
             auto last_connection = count == 1;
             auto connection_close = false;
@@ -599,6 +642,14 @@ inline void set_nonblocking(socket_t sock, bool nonblocking)
 #endif
 }
 
+// Send small writes straight away rather than holding them back to batch
+// with the next, as requests and responses are written in several pieces
+inline void set_nodelay(socket_t sock)
+{
+    int yes = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&yes), sizeof(yes));
+}
+
 inline bool is_connection_error()
 {
 #ifdef _WIN32
@@ -874,9 +925,9 @@ inline bool read_content_chunked(Stream& strm, std::string& out)
 template <typename T>
 bool read_content(Stream& strm, T& x, Progress progress = Progress())
 {
-    auto len = get_header_value_int(x.headers, "Content-Length", 0);
-
-    if (len) {
+    // An explicit zero length still ends the body, the connection may be kept alive
+    if (x.has_header("Content-Length")) {
+        auto len = get_header_value_int(x.headers, "Content-Length", 0);
         return read_content_with_length(strm, x.body, len, progress);
     } else {
         const auto& encoding = get_header_value(x.headers, "Transfer-Encoding", "");
@@ -1272,6 +1323,85 @@ public:
 static WSInit wsinit_;
 #endif
 
+// Fixed set of threads running tasks from a bounded queue
+class ThreadPool {
+public:
+    ThreadPool(size_t count, size_t max_queued)
+        : max_queued_((std::max)(max_queued, size_t(1)))
+        , shutdown_(false)
+    {
+        for (size_t i = 0; i < (std::max)(count, size_t(1)); i++) {
+            threads_.emplace_back([this]() { work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        shutdown();
+    }
+
+    // Queue a task, waiting while the queue is full
+    void enqueue(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_available_.wait(lock, [this]() { return tasks_.size() < max_queued_; });
+            tasks_.push_back(std::move(task));
+        }
+        task_available_.notify_one();
+    }
+
+    // Number of tasks waiting for a thread
+    size_t queued() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tasks_.size();
+    }
+
+    bool is_shutting_down() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return shutdown_;
+    }
+
+    // Run the tasks already queued, then stop the threads
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutdown_ = true;
+        }
+        task_available_.notify_all();
+
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+    }
+
+private:
+    void work() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                task_available_.wait(lock, [this]() { return shutdown_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            space_available_.notify_one();
+
+            task();
+        }
+    }
+
+    std::vector<std::thread>          threads_;
+    std::deque<std::function<void()>> tasks_;
+    const size_t                      max_queued_;
+    bool                              shutdown_;
+    std::mutex                        mutex_;
+    std::condition_variable           task_available_;
+    std::condition_variable           space_available_;
+};
+
 } // namespace detail
 
 // Header utilities
@@ -1426,7 +1556,8 @@ inline Server::Server()
     : keep_alive_max_count_(5)
     , is_running_(false)
     , svr_sock_(INVALID_SOCKET)
-    , running_threads_(0)
+    , thread_pool_count_(CPPHTTPLIB_THREAD_POOL_COUNT)
+    , thread_pool_max_queued_(CPPHTTPLIB_THREAD_POOL_MAX_QUEUED)
 {
 #ifndef _WIN32
     signal(SIGPIPE, SIG_IGN);
@@ -1491,6 +1622,22 @@ inline void Server::set_keep_alive_max_count(size_t count)
     keep_alive_max_count_ = count;
 }
 
+inline bool Server::yield_connection() const
+{
+    return thread_pool_ && (thread_pool_->queued() > 0 || thread_pool_->is_shutting_down());
+}
+
+inline void Server::set_thread_pool(size_t count, size_t max_queued)
+{
+    thread_pool_count_ = count;
+    thread_pool_max_queued_ = max_queued;
+}
+
+inline int Server::bind_to_port(const char* host, int port, int socket_flags)
+{
+    return bind_internal(host, port, socket_flags);
+}
+
 inline int Server::bind_to_any_port(const char* host, int socket_flags)
 {
     return bind_internal(host, 0, socket_flags);
@@ -1580,6 +1727,11 @@ inline void Server::write_response(Stream& strm, bool last_connection, const Req
             res.set_header("Content-Type", "text/plain");
         }
 
+    }
+
+    // Always sent, so keep alive clients know where an empty body ends,
+    // unless the handler has already framed the body in chunks
+    if (!res.has_header("Transfer-Encoding")) {
         auto length = std::to_string(res.body.size());
         res.set_header("Content-Length", length.c_str());
     }
@@ -1627,7 +1779,8 @@ inline socket_t Server::create_server_socket(const char* host, int port, int soc
             if (::bind(sock, ai.ai_addr, ai.ai_addrlen)) {
                   return false;
             }
-            if (::listen(sock, 5)) { // Listen through 5 channels
+            // Connections wait here once the thread pool queue is full
+            if (::listen(sock, SOMAXCONN)) {
                 return false;
             }
             return true;
@@ -1667,6 +1820,7 @@ inline bool Server::listen_internal()
 {
     auto ret = true;
 
+    thread_pool_.reset(new detail::ThreadPool(thread_pool_count_, thread_pool_max_queued_));
     is_running_ = true;
 
     for (;;) {
@@ -1692,30 +1846,16 @@ inline bool Server::listen_internal()
             break;
         }
 
-        // TODO: Use thread pool...
-        std::thread([=]() {
-            {
-                std::lock_guard<std::mutex> guard(running_threads_mutex_);
-                running_threads_++;
-            }
-
-            read_and_close_socket(sock);
+        detail::set_nodelay(sock);
 
-            {
-                std::lock_guard<std::mutex> guard(running_threads_mutex_);
-                running_threads_--;
-            }
-        }).detach();
+        // Waits while the queue is full, so further connections back up in
+        // the listen backlog rather than in threads
+        thread_pool_->enqueue([=]() { read_and_close_socket(sock); });
     }
 
-    // TODO: Use thread pool...
-    for (;;) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        std::lock_guard<std::mutex> guard(running_threads_mutex_);
-        if (!running_threads_) {
-            break;
-        }
-    }
+    // Finish the connections already accepted
+    thread_pool_->shutdown();
+    thread_pool_.reset();
 
     is_running_ = false;
 
@@ -1845,7 +1985,8 @@ inline bool Server::read_and_close_socket(socket_t sock)
         keep_alive_max_count_,
         [this](Stream& strm, bool last_connection, bool& connection_close) {
             return process_request(strm, last_connection, connection_close);
-        });
+        },
+        [this]() { return yield_connection(); });
 }
 
 // HTTP client implementation
@@ -1883,6 +2024,7 @@ inline socket_t Client::create_client_socket() const
             }
 
             detail::set_nonblocking(sock, false);
+            detail::set_nodelay(sock);
             return true;
         });
 }
@@ -1943,10 +2085,10 @@ inline void Client::write_request(Stream& strm, Request& req)
         req.set_header("User-Agent", "cpp-httplib/0.2");
     }
 
-    // TODO: Support KeepAlive connection
-    // if (!req.has_header("Connection")) {
+    // Keep alive is left to callers that manage their own connections
+    if (!req.has_header("Connection")) {
         req.set_header("Connection", "close");
-    // }
+    }
 
     if (!req.body.empty()) {
         if (!req.has_header("Content-Type")) {
@@ -2158,7 +2300,8 @@ inline bool read_and_close_socket_ssl(
     // The upcoming 1.1.0 is going to be thread safe.
     SSL_CTX* ctx, std::mutex& ctx_mutex,
     U SSL_connect_or_accept, V setup,
-    T callback)
+    T callback,
+    const std::function<bool()>& yield = nullptr)
 {
     SSL* ssl = nullptr;
     {
@@ -2182,9 +2325,7 @@ inline bool read_and_close_socket_ssl(
     if (keep_alive_max_count > 0) {
         auto count = keep_alive_max_count;
         while (count > 0 &&
-               detail::select_read(sock,
-                   CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND,
-                   CPPHTTPLIB_KEEPALIVE_TIMEOUT_USECOND) > 0) {
+               detail::wait_for_request(sock, count < keep_alive_max_count ? yield : nullptr)) {
             SSLSocketStream strm(sock, ssl);
             auto last_connection = count == 1;
             auto connection_close = false;
@@ -2300,7 +2441,8 @@ inline bool SSLServer::read_and_close_socket(socket_t sock)
         [](SSL* /*ssl*/) {},
         [this](Stream& strm, bool last_connection, bool& connection_close) {
             return process_request(strm, last_connection, connection_close);
-        });
+        },
+        [this]() { return yield_connection(); });
 }
 
 // SSL HTTP client implementation
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocator returning memory aligned to a cache line, so the start of every
+// array lines up with SIMD loads
+////////////////////////////////////////////////////////////////////////////////
+template<class T, std::size_t Alignment = 64>
+class AlignedAllocator
+{
+    public:
+    using value_type = T;
+
+    template<class U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* pointer, std::size_t) noexcept
+    {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template<class U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept
+    {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept
+    {
+        return false;
+    }
+};
+
+// Vector with cache line aligned storage
+template<class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+#include "BatchAnalyzer.hpp"
+#include "HistorySourceBinary.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+
+#if defined(WIN32)
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <dirent.h>
+    #include <fnmatch.h>
+    #include <sys/stat.h>
+#endif
+
+namespace
+{
+#if defined(WIN32)
+    const char* Separators = "/\\";
+
+    bool isDirectory(const std::string& path)
+    {
+        auto attributes = GetFileAttributesA(path.c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Names of the files in a directory matching a wildcard pattern
+    ////////////////////////////////////////////////////////////////////////////
+    std::vector<std::string> listDirectory(const std::string& directory, const std::string& pattern)
+    {
+        std::vector<std::string> names;
+
+        WIN32_FIND_DATAA entry;
+        auto find = FindFirstFileA((directory + "\\" + pattern).c_str(), &entry);
+        if (find == INVALID_HANDLE_VALUE)
+        {
+            return names;
+        }
+
+        do
+        {
+            if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                names.push_back(entry.cFileName);
+            }
+        }
+        while (FindNextFileA(find, &entry));
+
+        FindClose(find);
+        return names;
+    }
+#else
+    const char* Separators = "/";
+
+    bool isDirectory(const std::string& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Names of the files in a directory matching a wildcard pattern
+    ////////////////////////////////////////////////////////////////////////////
+    std::vector<std::string> listDirectory(const std::string& directory, const std::string& pattern)
+    {
+        std::vector<std::string> names;
+
+        auto dir = opendir(directory.c_str());
+        if (!dir)
+        {
+            return names;
+        }
+
+        while (auto entry = readdir(dir))
+        {
+            // Hidden files only match patterns starting with a dot
+            if (fnmatch(pattern.c_str(), entry->d_name, FNM_PERIOD) != 0)
+            {
+                continue;
+            }
+
+            struct stat info;
+            if (stat((directory + "/" + entry->d_name).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+            {
+                names.push_back(entry->d_name);
+            }
+        }
+
+        closedir(dir);
+        return names;
+    }
+#endif
+
+    // Whether a file in a directory looks like history
+    bool isHistory(const std::string& path)
+    {
+        auto dot = path.rfind('.');
+        HistorySourceFile::Format format;
+        return (dot != std::string::npos && HistorySourceFile::parseFormat(path.substr(dot + 1), format))
+            || HistorySourceBinary::isBinary(path);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BatchAnalyzer::BatchAnalyzer(unsigned workers) :
+m_workers(Parallel::threadCount(workers)) {}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchAnalyzer::setMode(HistorySourceFile::Mode mode)
+{
+    m_mode = mode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchAnalyzer::setFormat(HistorySourceFile::Format format)
+{
+    m_format = format;
+    m_formatSet = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchAnalyzer::setRange(std::int64_t from, std::int64_t to)
+{
+    m_from = from;
+    m_to = to;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<BatchAnalyzer::Result> BatchAnalyzer::run(const std::vector<std::string>& paths) const
+{
+    std::vector<Result> results(paths.size());
+    Parallel::forEach(m_workers, paths.size(), [this, &paths, &results](std::size_t index)
+    {
+        results[index] = analyze(paths[index]);
+    });
+    return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<std::string> BatchAnalyzer::expand(const std::vector<std::string>& patterns)
+{
+    std::vector<std::string> paths;
+
+    for (auto& pattern : patterns)
+    {
+        std::vector<std::string> names;
+        std::string directory;
+
+        auto separator = pattern.find_last_of(Separators);
+        auto name = separator == std::string::npos ? pattern : pattern.substr(separator + 1);
+
+        if (name.find_first_of("*?") != std::string::npos)
+        {
+            directory = separator == std::string::npos ? "" : pattern.substr(0, separator + 1);
+            names = listDirectory(directory.empty() ? "." : directory, name);
+        }
+        else if (isDirectory(pattern))
+        {
+            directory = pattern;
+            if (directory.find_last_of(Separators) != directory.size() - 1)
+            {
+                directory += '/';
+            }
+            names = listDirectory(pattern, "*");
+            names.erase(std::remove_if(names.begin(), names.end(), [&directory](const std::string& file)
+            {
+                return !isHistory(directory + file);
+            }), names.end());
+        }
+        else
+        {
+            paths.push_back(pattern);
+            continue;
+        }
+
+        if (names.empty())
+        {
+            std::cout << "No history files found for " << pattern << std::endl;
+        }
+
+        std::sort(names.begin(), names.end());
+        for (auto& file : names)
+        {
+            paths.push_back(directory + file);
+        }
+    }
+
+    return paths;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BatchAnalyzer::Result BatchAnalyzer::analyze(const std::string& path) const
+{
+    Result result;
+    result.path = path;
+
+    std::unique_ptr<HistorySource> source;
+    if (HistorySourceBinary::isBinary(path))
+    {
+        source = std::make_unique<HistorySourceBinary>(path);
+    }
+    else
+    {
+        source = std::make_unique<HistorySourceFile>(path, m_mode,
+            m_formatSet ? m_format : HistorySourceFile::formatFromPath(path));
+    }
+
+    HistoryAnalyzer analyzer;
+    {
+        Profiler::Scope scope("source");
+        if (!source->read(analyzer))
+        {
+            std::cout << "Failed to read " << path << std::endl;
+            return result;
+        }
+    }
+
+    Profiler::Scope scope("analyze");
+    if (m_from == std::numeric_limits<std::int64_t>::min() && m_to == std::numeric_limits<std::int64_t>::max())
+    {
+        result.stats = analyzer.analyze();
+        result.ok = true;
+        return result;
+    }
+
+    auto stats = analyzer.analyze(m_from, m_to);
+    if (!stats)
+    {
+        std::cout << "No data found in range in " << path << std::endl;
+        return result;
+    }
+    result.stats = *stats;
+    result.ok = true;
+    return result;
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "HistoryAnalyzer.hpp"
+#include "HistorySourceFile.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// Analyzes many history files in one go
+//
+// Files are handed out to a pool of workers, each reading, parsing and
+// analyzing a whole file at a time, so one file's I/O overlaps another's
+// parsing. A worker holds only the file it's on, so memory stays bounded by
+// the largest files rather than the total
+////////////////////////////////////////////////////////////////////////////////
+class BatchAnalyzer final
+{
+    public:
+    struct Result
+    {
+        std::string             path;
+        bool                    ok = false;
+        HistoryAnalyzer::Stats  stats;
+    };
+
+    // Run with this many workers, 0 meaning one per core
+    explicit BatchAnalyzer(unsigned workers = 0);
+
+    // How JSON files are read, and their encoding, by default from the
+    // extension of each file
+    void setMode(HistorySourceFile::Mode mode);
+    void setFormat(HistorySourceFile::Format format);
+
+    // Only analyze data from..to inclusive in each file
+    void setRange(std::int64_t from, std::int64_t to);
+
+    // Analyze every file, returning the results in the same order
+    std::vector<Result> run(const std::vector<std::string>& paths) const;
+
+    // Expand files, directories and wildcard patterns (* and ? in the last
+    // part of the path) into a list of files, in sorted order within each.
+    // Directories give the history files directly inside them, recognised by
+    // their extension or binary header
+    static std::vector<std::string> expand(const std::vector<std::string>& patterns);
+
+    private:
+    Result analyze(const std::string& path) const;
+
+    unsigned                    m_workers;
+    HistorySourceFile::Mode     m_mode = HistorySourceFile::Mode::Stream;
+    bool                        m_formatSet = false;
+    HistorySourceFile::Format   m_format = HistorySourceFile::Format::JSON;
+    std::int64_t                m_from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t                m_to = std::numeric_limits<std::int64_t>::max();
+};
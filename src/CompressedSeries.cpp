@@ -0,0 +1,503 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+
+#include "CompressedSeries.hpp"
+#include "Selection.hpp"
+#include "StatsAccumulator.hpp"
+
+namespace
+{
+    std::uint64_t toBits(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double fromBits(std::uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    unsigned leadingZeros(std::uint64_t value)
+    {
+        unsigned count = 0;
+        for (auto bit = std::uint64_t(1) << 63; bit && !(value & bit); bit >>= 1)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    unsigned trailingZeros(std::uint64_t value)
+    {
+        unsigned count = 0;
+        for (auto bit = std::uint64_t(1); bit && !(value & bit); bit <<= 1)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    // Whether a value fits in a two's complement field of the given width
+    bool fits(std::int64_t value, unsigned bits)
+    {
+        auto limit = std::int64_t(1) << (bits - 1);
+        return value >= -limit && value < limit;
+    }
+
+    std::uint64_t lowBits(unsigned bits)
+    {
+        return bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Reads bits back from the stream, most significant first
+    ////////////////////////////////////////////////////////////////////////////
+    class BitReader
+    {
+        public:
+        BitReader(const std::vector<std::uint64_t>& words, std::uint64_t offset) :
+        m_words(words),
+        m_offset(offset)
+        {
+        }
+
+        std::uint64_t read(unsigned bits)
+        {
+            auto word = m_offset / 64;
+            auto used = static_cast<unsigned>(m_offset % 64);
+            m_offset += bits;
+
+            // Bits are packed from the top of each word down
+            auto available = 64 - used;
+            if (bits <= available)
+            {
+                return (m_words[word] >> (available - bits)) & lowBits(bits);
+            }
+
+            auto rest = bits - available;
+            auto high = m_words[word] & lowBits(available);
+            return (high << rest) | (m_words[word + 1] >> (64 - rest));
+        }
+
+        bool readBit()
+        {
+            return read(1) != 0;
+        }
+
+        // Read a two's complement field
+        std::int64_t readSigned(unsigned bits)
+        {
+            auto value = read(bits);
+            if (bits < 64 && (value >> (bits - 1)) & 1)
+            {
+                value |= ~lowBits(bits);
+            }
+            return static_cast<std::int64_t>(value);
+        }
+
+        private:
+        const std::vector<std::uint64_t>&   m_words;
+        std::uint64_t                       m_offset;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CompressedSeries::CompressedSeries(const HistoryAnalyzer& analyzer)
+{
+    auto& times = analyzer.getTimes();
+    auto& prices = analyzer.getPrices();
+    for (std::size_t i = 0; i < analyzer.size(); ++i)
+    {
+        append(times[i], prices[i]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CompressedSeries::append(std::int64_t time, double price)
+{
+    if (m_size && time <= m_lastTime)
+    {
+        return false;
+    }
+
+    auto bits = toBits(price);
+
+    // Start a new block, with the first price stored whole
+    if (m_blocks.empty() || m_blocks.back().count == BlockSize)
+    {
+        m_blocks.push_back({m_bitCount, time, 1});
+        writeBits(bits, 64);
+
+        m_lastTime = time;
+        m_lastDelta = 0;
+        m_lastPrice = bits;
+        m_lastLeading = 64;
+        m_lastTrailing = 0;
+        ++m_size;
+        return true;
+    }
+
+    // Delta of delta, with short fields for small changes in spacing
+    auto delta = time - m_lastTime;
+    auto deltaOfDelta = delta - m_lastDelta;
+    if (deltaOfDelta == 0)
+    {
+        writeBits(0, 1);
+    }
+    else if (fits(deltaOfDelta, 7))
+    {
+        writeBits(0b10, 2);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 7);
+    }
+    else if (fits(deltaOfDelta, 9))
+    {
+        writeBits(0b110, 3);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 9);
+    }
+    else if (fits(deltaOfDelta, 12))
+    {
+        writeBits(0b1110, 4);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 12);
+    }
+    else
+    {
+        writeBits(0b1111, 4);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 64);
+    }
+
+    // XOR with the previous price, storing only the bits that differ. If they
+    // fall inside the previous window of meaningful bits, that's reused
+    auto difference = bits ^ m_lastPrice;
+    if (difference == 0)
+    {
+        writeBits(0, 1);
+    }
+    else
+    {
+        auto leading = std::min(leadingZeros(difference), 31u);
+        auto trailing = trailingZeros(difference);
+
+        if (m_lastLeading < 64 && leading >= m_lastLeading && trailing >= m_lastTrailing)
+        {
+            writeBits(0b10, 2);
+            writeBits(difference >> m_lastTrailing, 64 - m_lastLeading - m_lastTrailing);
+        }
+        else
+        {
+            auto meaningful = 64 - leading - trailing;
+            writeBits(0b11, 2);
+            writeBits(leading, 5);
+            writeBits(meaningful - 1, 6);
+            writeBits(difference >> trailing, meaningful);
+
+            m_lastLeading = leading;
+            m_lastTrailing = trailing;
+        }
+    }
+
+    m_lastTime = time;
+    m_lastDelta = delta;
+    m_lastPrice = bits;
+    ++m_blocks.back().count;
+    ++m_size;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CompressedSeries::size() const
+{
+    return m_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CompressedSeries::blockCount() const
+{
+    return m_blocks.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CompressedSeries::memoryUsage() const
+{
+    return sizeof(*this) + m_words.capacity() * sizeof(std::uint64_t) + m_blocks.capacity() * sizeof(Block);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CompressedSeries::decodeBlock(std::size_t block, std::int64_t* times, double* prices) const
+{
+    auto& info = m_blocks[block];
+    BitReader reader(m_words, info.bitOffset);
+
+    auto time = info.firstTime;
+    auto price = reader.read(64);
+    std::int64_t delta = 0;
+    unsigned leading = 64, trailing = 0;
+
+    times[0] = time;
+    prices[0] = fromBits(price);
+
+    for (std::size_t i = 1; i < info.count; ++i)
+    {
+        // Control bits give the width of the delta of delta
+        std::int64_t deltaOfDelta = 0;
+        if (reader.readBit())
+        {
+            if (!reader.readBit())
+            {
+                deltaOfDelta = reader.readSigned(7);
+            }
+            else if (!reader.readBit())
+            {
+                deltaOfDelta = reader.readSigned(9);
+            }
+            else if (!reader.readBit())
+            {
+                deltaOfDelta = reader.readSigned(12);
+            }
+            else
+            {
+                deltaOfDelta = reader.readSigned(64);
+            }
+        }
+        delta += deltaOfDelta;
+        time += delta;
+
+        if (reader.readBit())
+        {
+            if (reader.readBit())
+            {
+                leading = static_cast<unsigned>(reader.read(5));
+                auto meaningful = static_cast<unsigned>(reader.read(6)) + 1;
+                trailing = 64 - leading - meaningful;
+            }
+            price ^= reader.read(64 - leading - trailing) << trailing;
+        }
+
+        times[i] = time;
+        prices[i] = fromBits(price);
+    }
+    return info.count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CompressedSeries::forEachBlock(const std::function<void(const std::int64_t* times, const double* prices,
+    std::size_t count, std::size_t firstIndex)>& function) const
+{
+    std::int64_t times[BlockSize];
+    double prices[BlockSize];
+
+    std::size_t firstIndex = 0;
+    for (std::size_t block = 0; block < m_blocks.size(); ++block)
+    {
+        auto count = decodeBlock(block, times, prices);
+        function(times, prices, count, firstIndex);
+        firstIndex += count;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistoryAnalyzer::DataPoint CompressedSeries::getDataPoint(std::size_t index) const
+{
+    std::int64_t times[BlockSize];
+    double prices[BlockSize];
+
+    decodeBlock(index / BlockSize, times, prices);
+    return {times[index % BlockSize], prices[index % BlockSize]};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const HistoryAnalyzer::Stats CompressedSeries::analyze() const
+{
+    HistoryAnalyzer::Stats stats = {};
+    stats.dataSize = m_size;
+
+    if (!m_size)
+    {
+        return stats;
+    }
+
+    StatsAccumulator accumulator;
+    forEachBlock([&accumulator](const std::int64_t*, const double* prices, std::size_t count, std::size_t firstIndex)
+    {
+        accumulator.add(prices, count, firstIndex);
+    });
+
+    stats.highest = getDataPoint(accumulator.argMax());
+    stats.lowest = getDataPoint(accumulator.argMin());
+    stats.meanPrice = accumulator.mean();
+    stats.standardDeviation = accumulator.standardDeviation();
+
+    // Selection passes over the blocks, decoding each block every pass
+    stats.medianPrice = Selection::streamingMedian(
+    [this](const std::function<void(const double*, std::size_t)>& visit)
+    {
+        forEachBlock([&visit](const std::int64_t*, const double* prices, std::size_t count, std::size_t)
+        {
+            visit(prices, count);
+        });
+    }, m_size);
+
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<HistoryAnalyzer::Stats> CompressedSeries::analyze(std::int64_t from, std::int64_t to) const
+{
+    StatsAccumulator accumulator;
+    std::size_t size = 0;
+    forEachBlockIn(from, to, [&accumulator, &size](const std::int64_t*, const double* prices, std::size_t count,
+        std::size_t firstIndex)
+    {
+        accumulator.add(prices, count, firstIndex);
+        size += count;
+    });
+
+    if (!size)
+    {
+        return {};
+    }
+
+    HistoryAnalyzer::Stats stats = {};
+    stats.dataSize = size;
+    stats.highest = getDataPoint(accumulator.argMax());
+    stats.lowest = getDataPoint(accumulator.argMin());
+    stats.meanPrice = accumulator.mean();
+    stats.standardDeviation = accumulator.standardDeviation();
+
+    stats.medianPrice = Selection::streamingMedian(
+    [this, from, to](const std::function<void(const double*, std::size_t)>& visit)
+    {
+        forEachBlockIn(from, to, [&visit](const std::int64_t*, const double* prices, std::size_t count, std::size_t)
+        {
+            visit(prices, count);
+        });
+    }, size);
+
+    return optional<HistoryAnalyzer::Stats>(stats);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<double> CompressedSeries::quantile(std::int64_t from, std::int64_t to, double q) const
+{
+    Selection::Blocks blocks = [this, from, to](const std::function<void(const double*, std::size_t)>& visit)
+    {
+        forEachBlockIn(from, to, [&visit](const std::int64_t*, const double* prices, std::size_t count, std::size_t)
+        {
+            visit(prices, count);
+        });
+    };
+
+    std::size_t size = 0;
+    blocks([&size](const double*, std::size_t count)
+    {
+        size += count;
+    });
+
+    if (!size)
+    {
+        return {};
+    }
+
+    q = std::min(std::max(q, 0.), 1.);
+    auto position = q * static_cast<double>(size - 1);
+    auto lowerRank = static_cast<std::size_t>(position);
+    auto fraction = position - static_cast<double>(lowerRank);
+
+    auto value = Selection::streamingKthSmallest(blocks, lowerRank);
+    if (fraction > 0.)
+    {
+        value += (Selection::streamingKthSmallest(blocks, lowerRank + 1) - value) * fraction;
+    }
+    return optional<double>(value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CompressedSeries::decompress(HistoryAnalyzer& analyzer) const
+{
+    AlignedVector<std::int64_t> times(m_size);
+    AlignedVector<double> prices(m_size);
+
+    for (std::size_t block = 0; block < m_blocks.size(); ++block)
+    {
+        decodeBlock(block, times.data() + block * BlockSize, prices.data() + block * BlockSize);
+    }
+    analyzer.assign(std::move(times), std::move(prices));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CompressedSeries::forEachBlockIn(std::int64_t from, std::int64_t to, const std::function<void(
+    const std::int64_t* times, const double* prices, std::size_t count, std::size_t firstIndex)>& function) const
+{
+    std::int64_t times[BlockSize];
+    double prices[BlockSize];
+
+    // Times only increase, so the range starts in the last block starting
+    // at or before from
+    auto next = std::upper_bound(m_blocks.begin(), m_blocks.end(), from,
+        [](std::int64_t time, const Block& block) { return time < block.firstTime; });
+    std::size_t block = next == m_blocks.begin() ? 0 : static_cast<std::size_t>(next - m_blocks.begin()) - 1;
+
+    for (; block < m_blocks.size() && m_blocks[block].firstTime <= to; ++block)
+    {
+        auto count = decodeBlock(block, times, prices);
+        auto begin = static_cast<std::size_t>(std::lower_bound(times, times + count, from) - times);
+        auto end = static_cast<std::size_t>(std::upper_bound(times, times + count, to) - times);
+        if (begin < end)
+        {
+            function(times + begin, prices + begin, end - begin, block * BlockSize + begin);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CompressedSeries::writeBits(std::uint64_t value, unsigned bits)
+{
+    value &= lowBits(bits);
+
+    auto used = static_cast<unsigned>(m_bitCount % 64);
+    if (used == 0)
+    {
+        m_words.push_back(0);
+    }
+
+    // Pack from the top of each word down, spilling into the next word
+    auto available = 64 - used;
+    if (bits <= available)
+    {
+        m_words.back() |= value << (available - bits);
+    }
+    else
+    {
+        auto rest = bits - available;
+        m_words.back() |= value >> rest;
+        m_words.push_back(value << (64 - rest));
+    }
+    m_bitCount += bits;
+}
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "HistoryAnalyzer.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// Price history compressed in blocks, after Facebook's Gorilla
+//
+// Each block of up to BlockSize points is a bit stream. Timestamps are stored
+// as the change in the gap between them (delta of delta), so a regular series
+// takes one bit per timestamp. Prices are XORed with the previous price, and
+// only the bits that differ are stored.
+//
+// Blocks decode independently into small buffers, so the series can be
+// analyzed a block at a time without ever decompressing all of it
+////////////////////////////////////////////////////////////////////////////////
+class CompressedSeries final
+{
+    public:
+    // Points per block, small enough that a decoded block stays in cache
+    static constexpr std::size_t BlockSize = 1024;
+
+    CompressedSeries() = default;
+
+    // Compress everything in an analyzer
+    explicit CompressedSeries(const HistoryAnalyzer& analyzer);
+
+    // Append a data point to the end of the series
+    // Returns false if it isn't later than the last data point
+    bool append(std::int64_t time, double price);
+
+    // Number of data points
+    std::size_t size() const;
+
+    // Number of blocks, all but the last holding BlockSize points
+    std::size_t blockCount() const;
+
+    // Approximate memory used, in bytes
+    std::size_t memoryUsage() const;
+
+    // Decode a block into buffers of at least BlockSize values
+    // Returns the number of points decoded
+    std::size_t decodeBlock(std::size_t block, std::int64_t* times, double* prices) const;
+
+    // Call function(times, prices, count, firstIndex) with each block in turn
+    void forEachBlock(const std::function<void(const std::int64_t* times, const double* prices,
+        std::size_t count, std::size_t firstIndex)>& function) const;
+
+    // Get a single data point, decoding its block
+    HistoryAnalyzer::DataPoint getDataPoint(std::size_t index) const;
+
+    // Stats over the whole series, streaming through it block by block
+    const HistoryAnalyzer::Stats analyze() const;
+
+    // Stats over only the data from..to inclusive, decoding just the blocks
+    // the range overlaps
+    // Returns nothing if there's no data in the range
+    optional<HistoryAnalyzer::Stats> analyze(std::int64_t from, std::int64_t to) const;
+
+    // A price quantile over the data from..to inclusive, q from 0 to 1,
+    // interpolating between the closest ranks
+    // Returns nothing if there's no data in the range
+    optional<double> quantile(std::int64_t from, std::int64_t to, double q) const;
+
+    // Decompress everything into an analyzer
+    void decompress(HistoryAnalyzer& analyzer) const;
+
+    private:
+    struct Block
+    {
+        std::uint64_t   bitOffset;  // Where the block starts in the stream
+        std::int64_t    firstTime;
+        std::uint32_t   count;
+    };
+
+    // As forEachBlock, but with only the points from..to inclusive, and
+    // skipping blocks entirely outside the range
+    void forEachBlockIn(std::int64_t from, std::int64_t to, const std::function<void(const std::int64_t* times,
+        const double* prices, std::size_t count, std::size_t firstIndex)>& function) const;
+
+    // Append the low bits of a value to the stream
+    void writeBits(std::uint64_t value, unsigned bits);
+
+    std::vector<std::uint64_t>  m_words;
+    std::uint64_t               m_bitCount = 0;
+    std::vector<Block>          m_blocks;
+    std::size_t                 m_size = 0;
+
+    // Encoder state for the last block
+    std::int64_t                m_lastTime = 0;
+    std::int64_t                m_lastDelta = 0;
+    std::uint64_t               m_lastPrice = 0;
+    unsigned                    m_lastLeading = 0;
+    unsigned                    m_lastTrailing = 0;
+};
@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <limits>
+
+#include "DateTime.hpp"
+
+namespace
+{
+    // Read a fixed number of digits
+    template<class T>
+    bool readDigits(std::string_view text, std::size_t pos, std::size_t count, T& out)
+    {
+        out = 0;
+        for (auto i = pos; i < pos + count; ++i)
+        {
+            auto c = text[i];
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+            out = out * 10 + static_cast<T>(c - '0');
+        }
+        return true;
+    }
+
+    // Write a fixed number of digits, zero padded
+    void writeDigits(char* out, std::uint64_t value, std::size_t count)
+    {
+        for (auto i = count; i > 0; --i)
+        {
+            out[i - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    bool isLeapYear(std::int64_t year)
+    {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    unsigned daysInMonth(std::int64_t year, unsigned month)
+    {
+        static const unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DateTime::parse(std::string_view text, std::int64_t& time)
+{
+    // [-]YYYY-MM-DD, with as many more year digits as format() writes
+    auto negative = !text.empty() && text[0] == '-';
+    std::size_t sign = negative ? 1 : 0;
+    auto yearEnd = text.find('-', sign);
+    std::uint64_t magnitude;
+    if (yearEnd == std::string_view::npos || yearEnd - sign < 4 || yearEnd - sign > 12 ||
+        !readDigits(text, sign, yearEnd - sign, magnitude))
+    {
+        return false;
+    }
+    auto year = negative ? -static_cast<std::int64_t>(magnitude) : static_cast<std::int64_t>(magnitude);
+
+    // The rest is laid out as it is after a four digit year
+    text.remove_prefix(yearEnd - 4);
+
+    unsigned month, day;
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-' ||
+        !readDigits(text, 5, 2, month) ||
+        !readDigits(text, 8, 2, day) ||
+        month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month))
+    {
+        return false;
+    }
+
+    // Optional HH:MM[:SS]
+    unsigned hour = 0, minute = 0, second = 0;
+    if (text.size() > 10)
+    {
+        if ((text.size() != 16 && text.size() != 19) ||
+            (text[10] != ' ' && text[10] != 'T') || text[13] != ':' ||
+            !readDigits(text, 11, 2, hour) ||
+            !readDigits(text, 14, 2, minute) ||
+            hour > 23 || minute > 59)
+        {
+            return false;
+        }
+
+        if (text.size() == 19 &&
+            (text[16] != ':' || !readDigits(text, 17, 2, second) || second > 59))
+        {
+            return false;
+        }
+    }
+
+    // Long years can be past the furthest timestamps either way
+    auto days = daysFromCivil(year, month, day);
+    std::int64_t seconds = hour * 3600 + minute * 60 + second;
+    if (days + 1 < (std::numeric_limits<std::int64_t>::min() + (SecondsPerDay - seconds)) / SecondsPerDay ||
+        days > (std::numeric_limits<std::int64_t>::max() - seconds) / SecondsPerDay)
+    {
+        return false;
+    }
+
+    time = days * SecondsPerDay + seconds;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DateTime::parseEnd(std::string_view text, std::int64_t& time)
+{
+    if (!parse(text, time))
+    {
+        return false;
+    }
+
+    // A plain date covers the whole of that day, as far as timestamps go
+    if (text.find_first_of(" T") == std::string_view::npos)
+    {
+        time += std::min(SecondsPerDay - 1, std::numeric_limits<std::int64_t>::max() - time);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string DateTime::format(std::int64_t time)
+{
+    char buffer[MaxLength];
+    return std::string(buffer, format(time, buffer));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t DateTime::format(std::int64_t time, char* out)
+{
+    auto days = time / SecondsPerDay;
+    auto seconds = time % SecondsPerDay;
+    if (seconds < 0)
+    {
+        --days;
+        seconds += SecondsPerDay;
+    }
+
+    std::int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    // At least four year digits, more if it needs them
+    std::size_t yearLength = 0;
+    if (year < 0)
+    {
+        out[yearLength++] = '-';
+    }
+    auto magnitude = year < 0 ? 0 - static_cast<std::uint64_t>(year) : static_cast<std::uint64_t>(year);
+    std::size_t digits = 4;
+    for (auto rest = magnitude / 10000; rest; rest /= 10)
+    {
+        ++digits;
+    }
+    writeDigits(out + yearLength, magnitude, digits);
+    yearLength += digits;
+
+    // The rest is laid out as it is after a four digit year
+    out += yearLength - 4;
+    out[4] = '-';
+    writeDigits(out + 5, month, 2);
+    out[7] = '-';
+    writeDigits(out + 8, day, 2);
+
+    if (!seconds)
+    {
+        return yearLength + 6;
+    }
+
+    out[10] = ' ';
+    writeDigits(out + 11, static_cast<std::uint64_t>(seconds / 3600), 2);
+    out[13] = ':';
+    writeDigits(out + 14, static_cast<std::uint64_t>(seconds / 60 % 60), 2);
+
+    if (!(seconds % 60))
+    {
+        return yearLength + 12;
+    }
+
+    out[16] = ':';
+    writeDigits(out + 17, static_cast<std::uint64_t>(seconds % 60), 2);
+    return yearLength + 15;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Both conversions are Howard Hinnant's public domain algorithms, see
+// http://howardhinnant.github.io/date_algorithms.html
+////////////////////////////////////////////////////////////////////////////////
+std::int64_t DateTime::daysFromCivil(std::int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    auto era = (year >= 0 ? year : year - 399) / 400;
+    auto yoe = static_cast<unsigned>(year - era * 400);
+    auto doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DateTime::civilFromDays(std::int64_t days, std::int64_t& year, unsigned& month, unsigned& day)
+{
+    days += 719468;
+    auto era = (days >= 0 ? days : days - 146096) / 146097;
+    auto doe = static_cast<unsigned>(days - era * 146097);
+    auto yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    auto doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    auto mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<std::int64_t>(yoe) + era * 400 + (month <= 2);
+}
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+////////////////////////////////////////////////////////////////////////////////
+// Conversion between date strings and compact integer timestamps
+//
+// Timestamps are seconds since 1970-01-01 00:00:00 UTC. Dates are accepted as
+// YYYY-MM-DD with an optional time of day (HH:MM or HH:MM:SS, separated by a
+// space or 'T') for intraday data. Years outside 0-9999 are signed and
+// expanded, as format() writes them
+////////////////////////////////////////////////////////////////////////////////
+class DateTime final
+{
+    public:
+
+    // Longest string format() can produce, a signed twelve digit year and a
+    // time of day
+    static constexpr std::size_t MaxLength = 28;
+
+    static constexpr std::int64_t SecondsPerDay = 86400;
+
+    // Parse a date string into a timestamp
+    // Returns false if the string isn't a valid date
+    static bool parse(std::string_view text, std::int64_t& time);
+
+    // As above, for the end of a range, so a plain date is the last second
+    // of that day
+    static bool parseEnd(std::string_view text, std::int64_t& time);
+
+    // Format a timestamp, leaving out the time of day if it's midnight and
+    // the seconds if they're zero. Years outside 0-9999 are written with as
+    // many digits as they need, and a '-' if negative, as ISO 8601 expanded
+    // years are
+    static std::string format(std::int64_t time);
+
+    // As above, writing to a buffer of at least MaxLength characters
+    // Returns the number of characters written
+    static std::size_t format(std::int64_t time, char* out);
+
+    // Days since epoch for a civil date, and back again
+    static std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day);
+    static void civilFromDays(std::int64_t days, std::int64_t& year, unsigned& month, unsigned& day);
+};
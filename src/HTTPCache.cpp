@@ -0,0 +1,267 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "DateTime.hpp"
+#include "HTTPCache.hpp"
+#include "HTTPConnectionPool.hpp"
+
+#if defined(WIN32)
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+namespace
+{
+    // First line of every entry file, bumped if the format changes
+    const std::string Magic = "bcstats-cache 1";
+
+    ////////////////////////////////////////////////////////////////////////////
+    // 64 bit FNV-1a hash, for naming entry files
+    ////////////////////////////////////////////////////////////////////////////
+    std::uint64_t hash(const std::string& text)
+    {
+        std::uint64_t value = 14695981039346656037ull;
+        for (unsigned char c : text)
+        {
+            value = (value ^ c) * 1099511628211ull;
+        }
+        return value;
+    }
+
+    void makeDirectory(const std::string& path)
+    {
+#if defined(WIN32)
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HTTPCache::HTTPCache(const std::string& directory, std::int64_t ttl) :
+HTTPCache(directory, ttl, HTTPConnectionPool::shared()) {}
+
+////////////////////////////////////////////////////////////////////////////////
+HTTPCache::HTTPCache(const std::string& directory, std::int64_t ttl, HTTPConnectionPool& pool) :
+m_directory(directory),
+m_ttl(ttl),
+m_pool(pool)
+{
+    makeDirectory(m_directory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<httplib::Response> HTTPCache::get(const std::string& host, int port, const std::string& path)
+{
+    auto key = host + ":" + std::to_string(port) + path;
+    auto now = static_cast<std::int64_t>(std::time(nullptr));
+    auto entry = load(key);
+
+    auto cached = [&entry]
+    {
+        auto res = std::make_shared<httplib::Response>();
+        res->status = 200;
+        res->body = entry->body;
+        return res;
+    };
+
+    // Fresh, or can never change
+    if (entry && (entry->permanent || now - entry->fetched < m_ttl))
+    {
+        return cached();
+    }
+
+    httplib::Headers headers;
+    if (entry && !entry->etag.empty())
+    {
+        headers.emplace("If-None-Match", entry->etag);
+    }
+    if (entry && !entry->lastModified.empty())
+    {
+        headers.emplace("If-Modified-Since", entry->lastModified);
+    }
+
+    auto res = m_pool.get(host, port, path, headers);
+    if (!res)
+    {
+        return res;
+    }
+
+    // Unchanged, so only the fetch time moves on
+    if (entry && res->status == 304)
+    {
+        entry->fetched = now;
+        entry->permanent = isClosedRange(path, now);
+        store(key, *entry);
+        return cached();
+    }
+
+    if (res->status == 200)
+    {
+        Entry fresh;
+        fresh.body = res->body;
+        fresh.etag = res->get_header_value("ETag");
+        fresh.lastModified = res->get_header_value("Last-Modified");
+        fresh.fetched = now;
+        fresh.permanent = isClosedRange(path, now);
+        store(key, fresh);
+    }
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<HTTPCache::Entry> HTTPCache::load(const std::string& key) const
+{
+    std::ifstream file(entryPath(key), std::ios::binary);
+    if (!file)
+    {
+        return {};
+    }
+
+    std::string magic, storedKey;
+    Entry entry;
+    std::string fetched, permanent;
+    if (!std::getline(file, magic) || magic != Magic
+        || !std::getline(file, storedKey)
+        || !std::getline(file, entry.etag)
+        || !std::getline(file, entry.lastModified)
+        || !std::getline(file, fetched)
+        || !std::getline(file, permanent))
+    {
+        return {};
+    }
+
+    // Different keys can hash the same, the stored key tells them apart
+    if (storedKey != key)
+    {
+        return {};
+    }
+
+    try
+    {
+        entry.fetched = std::stoll(fetched);
+    }
+    catch (const std::exception&)
+    {
+        return {};
+    }
+    entry.permanent = permanent == "1";
+
+    std::stringstream body;
+    body << file.rdbuf();
+    entry.body = body.str();
+    return optional<Entry>(std::move(entry));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HTTPCache::store(const std::string& key, const Entry& entry) const
+{
+    // Write to a temporary file and rename it over the entry, so readers
+    // never see half an entry
+    auto path = entryPath(key);
+    std::stringstream suffix;
+    suffix << ".tmp" << std::this_thread::get_id();
+    auto temporary = path + suffix.str();
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file << Magic << '\n'
+             << key << '\n'
+             << entry.etag << '\n'
+             << entry.lastModified << '\n'
+             << entry.fetched << '\n'
+             << (entry.permanent ? 1 : 0) << '\n';
+        file.write(entry.body.data(), static_cast<std::streamsize>(entry.body.size()));
+
+        if (!file)
+        {
+            std::cout << "Failed to write cache entry " << temporary << std::endl;
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+#if defined(WIN32)
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()))
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HTTPCache::remove(const std::string& key) const
+{
+    std::remove(entryPath(key).c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HTTPCache::isClosedRange(const std::string& path, std::int64_t now)
+{
+    auto query = path.find('?');
+    if (query == std::string::npos)
+    {
+        return false;
+    }
+
+    // Find the end parameter
+    for (auto begin = query + 1; begin < path.size();)
+    {
+        auto end = path.find('&', begin);
+        if (end == std::string::npos)
+        {
+            end = path.size();
+        }
+
+        auto param = std::string_view(path).substr(begin, end - begin);
+        if (param.substr(0, 4) == "end=")
+        {
+            std::int64_t time;
+            auto today = now - now % DateTime::SecondsPerDay;
+            return DateTime::parse(param.substr(4), time) && time < today;
+        }
+        begin = end + 1;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string HTTPCache::entryPath(const std::string& key) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(key)));
+    return m_directory + "/" + name + ".http";
+}
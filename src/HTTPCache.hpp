@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <http/httplib.hpp>
+
+#include "Optional.hpp"
+
+class HTTPConnectionPool;
+
+////////////////////////////////////////////////////////////////////////////////
+// On-disk cache of successful GET responses, keyed by host, port and path
+//
+// Responses younger than the TTL are served without touching the network.
+// Older ones are revalidated with If-None-Match / If-Modified-Since, so an
+// unchanged response costs a round trip but no download. Responses for date
+// ranges that ended before today never change, so they never expire.
+////////////////////////////////////////////////////////////////////////////////
+class HTTPCache final
+{
+    public:
+
+    ////////////////////////////////////////////////////////////////////////////
+    // A cached response:
+    //
+    // - The response body
+    // - Validators sent back when revalidating, empty if the server gave none
+    // - When the response was last fetched or revalidated, seconds since epoch
+    // - Whether the response can never change
+    ////////////////////////////////////////////////////////////////////////////
+    struct Entry
+    {
+        std::string     body;
+        std::string     etag;
+        std::string     lastModified;
+        std::int64_t    fetched = 0;
+        bool            permanent = false;
+    };
+
+    // Cache in the given directory, which is created if needed (but not its
+    // parents), treating entries older than ttl seconds as stale
+    HTTPCache(const std::string& directory, std::int64_t ttl);
+    HTTPCache(const std::string& directory, std::int64_t ttl, HTTPConnectionPool& pool);
+
+    // Make a GET request through the cache, returning nothing on failure
+    // Only responses with status 200 are cached
+    std::shared_ptr<httplib::Response> get(const std::string& host, int port, const std::string& path);
+
+    // Load, store and remove entries directly, keyed by "host:port/path"
+    optional<Entry> load(const std::string& key) const;
+    bool store(const std::string& key, const Entry& entry) const;
+    void remove(const std::string& key) const;
+
+    // Whether a query's end parameter (YYYY-MM-DD) is before the day of now
+    static bool isClosedRange(const std::string& path, std::int64_t now);
+
+    private:
+    // File an entry is stored in
+    std::string entryPath(const std::string& key) const;
+
+    const std::string   m_directory;
+    const std::int64_t  m_ttl;
+    HTTPConnectionPool& m_pool;
+};
@@ -0,0 +1,244 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "HTTPConnectionPool.hpp"
+
+namespace
+{
+    // Seconds to wait for a host to accept a connection, no longer than an
+    // idle kept alive connection is waited on
+    constexpr std::size_t ConnectTimeout = CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A client holding on to its socket between requests
+////////////////////////////////////////////////////////////////////////////////
+class HTTPConnectionPool::Connection final : public httplib::Client
+{
+    public:
+    Connection(const std::string& host, int port) :
+    httplib::Client(host.c_str(), port, ConnectTimeout),
+    m_key(host + ":" + std::to_string(port))
+    {
+    }
+
+    ~Connection()
+    {
+        close();
+    }
+
+    const std::string& key() const
+    {
+        return m_key;
+    }
+
+    bool isOpen() const
+    {
+        return m_socket != INVALID_SOCKET;
+    }
+
+    // Whether a request has been made on this connection before
+    bool isReused() const
+    {
+        return m_requests > 0;
+    }
+
+    // An idle connection only becomes readable once the server has closed it
+    bool isStale() const
+    {
+        return httplib::detail::select_read(m_socket, 0, 0) != 0;
+    }
+
+    bool connect()
+    {
+        m_socket = httplib::detail::create_socket(host_.c_str(), port_,
+            [this](socket_t sock, struct addrinfo& ai)
+            {
+                httplib::detail::set_nonblocking(sock, true);
+
+                auto ret = ::connect(sock, ai.ai_addr, static_cast<socklen_t>(ai.ai_addrlen));
+                if (ret < 0)
+                {
+                    if (httplib::detail::is_connection_error() ||
+                        !httplib::detail::wait_until_socket_is_ready(sock, timeout_sec_, 0))
+                    {
+                        return false;
+                    }
+                }
+
+                httplib::detail::set_nonblocking(sock, false);
+                httplib::detail::set_nodelay(sock);
+                return true;
+            });
+        m_requests = 0;
+        return isOpen();
+    }
+
+    // Make a request, leaving the connection open if the server allows it
+    bool request(httplib::Request& req, httplib::Response& res)
+    {
+        req.set_header("Connection", "keep-alive");
+
+        httplib::SocketStream stream(m_socket);
+        bool connectionClose = false;
+        auto ok = process_request(stream, req, res, connectionClose);
+        ++m_requests;
+
+        if (!ok || connectionClose)
+        {
+            close();
+        }
+        return ok;
+    }
+
+    void close()
+    {
+        if (isOpen())
+        {
+            httplib::detail::close_socket(m_socket);
+            m_socket = INVALID_SOCKET;
+        }
+    }
+
+    private:
+    const std::string   m_key;
+    socket_t            m_socket = INVALID_SOCKET;
+    std::size_t         m_requests = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+HTTPConnectionPool::HTTPConnectionPool(std::size_t maxIdle) :
+m_maxIdle(maxIdle)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HTTPConnectionPool::~HTTPConnectionPool() = default;
+
+////////////////////////////////////////////////////////////////////////////////
+HTTPConnectionPool& HTTPConnectionPool::shared()
+{
+    static HTTPConnectionPool pool;
+    return pool;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<httplib::Response> HTTPConnectionPool::get(const std::string& host, int port,
+    const std::string& path, const httplib::Headers& headers)
+{
+    if (path.empty())
+    {
+        return nullptr;
+    }
+
+    // A reused connection can be closed by the server at any moment, so
+    // failures on one are retried once on a fresh connection
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        auto connection = acquire(host, port);
+        if (!connection)
+        {
+            return nullptr;
+        }
+
+        httplib::Request req;
+        req.method = "GET";
+        req.path = path;
+        req.headers = headers;
+
+        auto res = std::make_shared<httplib::Response>();
+        auto reused = connection->isReused();
+        if (connection->request(req, *res))
+        {
+            release(std::move(connection));
+            return res;
+        }
+
+        if (!reused)
+        {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t HTTPConnectionPool::connectionsOpened() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_opened;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HTTPConnectionPool::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idle.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<HTTPConnectionPool::Connection> HTTPConnectionPool::acquire(const std::string& host, int port)
+{
+    auto key = host + ":" + std::to_string(port);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& idle = m_idle[key];
+        while (!idle.empty())
+        {
+            auto connection = std::move(idle.back());
+            idle.pop_back();
+            if (!connection->isStale())
+            {
+                return connection;
+            }
+        }
+    }
+
+    // Connect without holding the lock, it can take a while
+    auto connection = std::make_unique<Connection>(host, port);
+    if (!connection->connect())
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_opened;
+    return connection;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HTTPConnectionPool::release(std::unique_ptr<Connection> connection)
+{
+    if (!connection->isOpen())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& idle = m_idle[connection->key()];
+    if (idle.size() < m_maxIdle)
+    {
+        idle.push_back(std::move(connection));
+    }
+}
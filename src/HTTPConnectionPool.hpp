@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <http/httplib.hpp>
+
+////////////////////////////////////////////////////////////////////////////////
+// Pool of keep-alive HTTP connections, kept per host and port
+//
+// Requests reuse an idle connection to the same host when there is one, so
+// only the first request to a host pays for connecting. Safe to share
+// between threads, each concurrent request gets a connection of its own.
+////////////////////////////////////////////////////////////////////////////////
+class HTTPConnectionPool final
+{
+    public:
+    // Keeps at most maxIdle unused connections per host
+    HTTPConnectionPool(std::size_t maxIdle = 8);
+    ~HTTPConnectionPool();
+
+    HTTPConnectionPool(const HTTPConnectionPool&) = delete;
+    HTTPConnectionPool& operator=(const HTTPConnectionPool&) = delete;
+
+    // Pool shared by everything in the process
+    static HTTPConnectionPool& shared();
+
+    // Make a GET request, returning nothing if no response was received
+    std::shared_ptr<httplib::Response> get(const std::string& host, int port, const std::string& path,
+        const httplib::Headers& headers = httplib::Headers());
+
+    // Number of connections opened so far
+    std::size_t connectionsOpened() const;
+
+    // Close every idle connection
+    void clear();
+
+    private:
+    class Connection;
+
+    // Take an idle connection to the host, or open a new one
+    std::unique_ptr<Connection> acquire(const std::string& host, int port);
+    // Return a connection for reuse
+    void release(std::unique_ptr<Connection> connection);
+
+    const std::size_t   m_maxIdle;
+    mutable std::mutex  m_mutex;
+    std::size_t         m_opened = 0;
+    // Idle connections keyed by "host:port"
+    std::map<std::string, std::vector<std::unique_ptr<Connection>>> m_idle;
+};
@@ -22,13 +22,74 @@
 // SOFTWARE.
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <numeric>
 
+#include "DateTime.hpp"
 #include "HistoryAnalyzer.hpp"
+#include "HistoryParser.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+#include "Selection.hpp"
+#include "StatsAccumulator.hpp"
+
+namespace
+{
+    // Smallest chunk of prices worth handing to a thread
+    constexpr std::size_t MinChunk = 64 * 1024;
+
+    // Generations are handed out across all analyzers, so two never match
+    // unless both are empty
+    std::uint64_t nextGeneration()
+    {
+        static std::atomic<std::uint64_t> generations{0};
+        return ++generations;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Collects data points from the streaming parser
+    ////////////////////////////////////////////////////////////////////////////
+    struct Collector
+    {
+        AlignedVector<std::int64_t> times;
+        AlignedVector<double>       prices;
+        std::string                 invalid;
+
+        void operator()(std::string_view date, double price)
+        {
+            std::int64_t time;
+            if (DateTime::parse(date, time))
+            {
+                times.push_back(time);
+                prices.push_back(price);
+            }
+            else if (invalid.empty())
+            {
+                invalid = date;
+            }
+        }
+
+        // Check everything parsed was valid
+        bool valid() const
+        {
+            if (!invalid.empty())
+            {
+                std::cout << "Invalid bpi data point: " << invalid << std::endl;
+                return false;
+            }
+            return true;
+        }
+    };
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-bool HistoryAnalyzer::parse(nlohmann::json json)
+bool HistoryAnalyzer::parse(const nlohmann::json& json)
 {
+    Profiler::Scope scope("parse");
+
     if (json.is_null() || json.is_discarded())
     {
         std::cout << "json is null, failed to parse" << std::endl;
@@ -43,66 +104,274 @@ bool HistoryAnalyzer::parse(nlohmann::json json)
     }
 
     // Allocate memory for it
-    m_dataPoints.reserve(json["bpi"].size());
+    auto& bpi = json["bpi"];
+    AlignedVector<std::int64_t> times;
+    AlignedVector<double> prices;
+    times.reserve(bpi.size());
+    prices.reserve(bpi.size());
 
     // Iterate through it, populating our data points
-    for (auto& dp : json["bpi"].items())
+    for (auto& dp : bpi.items())
     {
-        m_dataPoints.push_back({dp.key(),dp.value()});
+        std::int64_t time;
+        if (!DateTime::parse(dp.key(), time) || !dp.value().is_number())
+        {
+            std::cout << "Invalid bpi data point: " << dp.key() << std::endl;
+            return false;
+        }
+        times.push_back(time);
+        prices.push_back(dp.value());
     }
 
-    // Sort the datapoints by price to make analyzing easier
-    std::sort(m_dataPoints.begin(), m_dataPoints.end(),
-    [](DataPoint a, DataPoint b)
+    assign(std::move(times), std::move(prices));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryAnalyzer::parse(const char* data, std::size_t size)
+{
+    Profiler::Scope scope("parse");
+
+    Collector collector;
+    if (!HistoryParser::parse(data, size, std::ref(collector)) || !collector.valid())
     {
-        return a.price > b.price;
-    });
+        return false;
+    }
 
+    assign(std::move(collector.times), std::move(collector.prices));
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryAnalyzer::parse(std::istream& stream)
+{
+    Profiler::Scope scope("parse");
+
+    Collector collector;
+    if (!HistoryParser::parse(stream, std::ref(collector)) || !collector.valid())
+    {
+        return false;
+    }
+
+    assign(std::move(collector.times), std::move(collector.prices));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryAnalyzer::assign(AlignedVector<std::int64_t> times, AlignedVector<double> prices)
+{
+    m_generation = nextGeneration();
+    {
+        std::lock_guard<std::mutex> lock(m_summaryMutex);
+        m_summary.reset();
+    }
+
+    // Keep the data in chronological order. It almost always arrives that way
+    // already, otherwise the arrays are separate, so sort an ordering then
+    // apply it to both
+    if (!std::is_sorted(times.begin(), times.end()))
+    {
+        Profiler::Scope scope("sort");
+
+        std::vector<std::size_t> order(times.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+        [&times](std::size_t a, std::size_t b)
+        {
+            return times[a] < times[b];
+        });
+
+        m_times.resize(order.size());
+        m_prices.resize(order.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            m_times[i] = times[order[i]];
+            m_prices[i] = prices[order[i]];
+        }
+        return;
+    }
+
+    m_times = std::move(times);
+    m_prices = std::move(prices);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 const HistoryAnalyzer::Stats HistoryAnalyzer::analyze() const
 {
-    Stats stats;
-    stats.dataSize = m_dataPoints.size();
+    Stats stats = {};
+    stats.dataSize = m_prices.size();
 
-    // Comparison function for datapoints
-    auto dpCompare = [](DataPoint a, DataPoint b)
+    if (m_prices.empty())
     {
-        return a.price < b.price;
-    };
+        return stats;
+    }
 
-    // Find highest and lowest
-    stats.highest = *std::max_element(m_dataPoints.begin(), m_dataPoints.end(), dpCompare);
-    stats.lowest = *std::min_element(m_dataPoints.begin(), m_dataPoints.end(), dpCompare);
+    std::lock_guard<std::mutex> lock(m_summaryMutex);
+    if (!m_summary)
+    {
+        summarize();
+    }
+
+    auto& accumulator = m_summary->accumulator;
+    stats.highest = getDataPoint(accumulator.argMax());
+    stats.lowest = getDataPoint(accumulator.argMin());
+    stats.meanPrice = accumulator.mean();
+    stats.standardDeviation = accumulator.standardDeviation();
+    stats.medianPrice = m_summary->tracking ? m_summary->medianTracker.median() : m_summary->median;
+
+    return stats;
+}
 
-    // Calculate mean and median
-    auto sum = std::accumulate(m_dataPoints.begin(),m_dataPoints.end(), 0., 
-    [](double total, DataPoint next)
+////////////////////////////////////////////////////////////////////////////////
+optional<HistoryAnalyzer::Stats> HistoryAnalyzer::analyze(std::int64_t from, std::int64_t to) const
+{
+    // Data is kept in chronological order, so the range is a contiguous slice
+    auto begin = static_cast<std::size_t>(std::lower_bound(m_times.begin(), m_times.end(), from) - m_times.begin());
+    auto end = static_cast<std::size_t>(std::upper_bound(m_times.begin(), m_times.end(), to) - m_times.begin());
+    if (begin >= end)
     {
-        return total + next.price;
-    });
+        return {};
+    }
+
+    Profiler::Scope scope("summarize");
+
+    StatsAccumulator accumulator;
+    Stats stats = {};
+    reduce(begin, end, accumulator, stats.medianPrice);
 
-    stats.meanPrice = sum / m_dataPoints.size();
+    stats.dataSize = end - begin;
+    stats.highest = getDataPoint(accumulator.argMax());
+    stats.lowest = getDataPoint(accumulator.argMin());
+    stats.meanPrice = accumulator.mean();
+    stats.standardDeviation = accumulator.standardDeviation();
+    return optional<Stats>(stats);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryAnalyzer::append(std::int64_t time, double price)
+{
+    // A time already in the series would count the same day twice
+    if (!m_times.empty() && time <= m_times.back())
+    {
+        std::cout << "Can't append data point for " << DateTime::format(time)
+            << ", it's not after the end of the series" << std::endl;
+        return false;
+    }
 
-    auto medianIndex = (stats.dataSize + 1)/2;
-    stats.medianPrice = m_dataPoints[medianIndex].price;
+    m_times.push_back(time);
+    m_prices.push_back(price);
+    m_generation = nextGeneration();
 
-    // Simple std dev calculation
-    double totalDev = std::accumulate(m_dataPoints.begin(), m_dataPoints.end(), 0.,
-    [&stats] (double f, DataPoint next)
+    // Keep any existing analysis up to date
+    std::lock_guard<std::mutex> lock(m_summaryMutex);
+    if (m_summary)
     {
-        return f + std::fabs(std::pow(next.price - stats.meanPrice,2));
+        m_summary->accumulator.add(price, m_prices.size() - 1);
+
+        // The median needs all the values to hand, so the first append pays
+        // for building the heaps once
+        if (m_summary->tracking)
+        {
+            m_summary->medianTracker.add(price);
+        }
+        else
+        {
+            m_summary->medianTracker.assign(m_prices.data(), m_prices.size());
+            m_summary->tracking = true;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryAnalyzer::append(std::string_view date, double price)
+{
+    std::int64_t time;
+    if (!DateTime::parse(date, time))
+    {
+        std::cout << "Invalid date: " << date << std::endl;
+        return false;
+    }
+    return append(time, price);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryAnalyzer::summarize() const
+{
+    Profiler::Scope scope("summarize");
+
+    m_summary = std::make_unique<Summary>();
+
+    reduce(0, m_prices.size(), m_summary->accumulator, m_summary->median);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryAnalyzer::reduce(std::size_t begin, std::size_t end, StatsAccumulator& accumulator, double& median) const
+{
+    auto threads = Parallel::threadCount(m_threadCount);
+    auto data = m_prices.data() + begin;
+    auto count = end - begin;
+
+    // Everything but the median in a single pass, split into chunks that are
+    // reduced concurrently then merged in order
+    std::vector<StatsAccumulator> partials(threads);
+    auto chunks = Parallel::forChunks(threads, count, MinChunk,
+    [data, begin, &partials](std::size_t chunkBegin, std::size_t chunkEnd, std::size_t chunk)
+    {
+        partials[chunk].add(data + chunkBegin, chunkEnd - chunkBegin, begin + chunkBegin);
     });
 
-    stats.standardDeviation = std::sqrt((totalDev / (stats.dataSize - 1)));
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        accumulator.merge(partials[chunk]);
+    }
 
-    return stats;
+    Profiler::Scope scope("median");
+    if (chunks > 1)
+    {
+        median = Selection::parallelMedian(data, count, threads);
+    }
+    else
+    {
+        // Selecting the median reorders, so work on a copy
+        std::vector<double> prices(data, data + count);
+        median = Selection::median(prices.data(), prices.size());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t HistoryAnalyzer::size() const
+{
+    return m_prices.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistoryAnalyzer::DataPoint HistoryAnalyzer::getDataPoint(std::size_t index) const
+{
+    return {m_times[index], m_prices[index]};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const AlignedVector<std::int64_t>& HistoryAnalyzer::getTimes() const
+{
+    return m_times;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const AlignedVector<double>& HistoryAnalyzer::getPrices() const
+{
+    return m_prices;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint64_t HistoryAnalyzer::generation() const
+{
+    return m_generation;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-const std::vector<HistoryAnalyzer::DataPoint>& HistoryAnalyzer::getDataPoints() const
+void HistoryAnalyzer::setThreadCount(unsigned threads)
 {
-    return m_dataPoints;
+    m_threadCount = threads;
 }
@@ -24,13 +24,27 @@
 
 #pragma once
 
-#include <string>
-#include <vector>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string_view>
 
 #include <json/json.hpp>
 
+#include "AlignedAllocator.hpp"
+#include "MedianTracker.hpp"
+#include "Optional.hpp"
+#include "StatsAccumulator.hpp"
+
 ////////////////////////////////////////////////////////////////////////////////
 // Class Responsible for analyzing json price history data and returning stats
+//
+// Data is stored as a structure of arrays, timestamps and prices each in
+// their own contiguous aligned array, so scans over prices only touch prices
+//
+// The result of analyze() is kept, and updated in O(log n) as data points
+// are appended, so repeated analysis of a growing series never rescans it
 ////////////////////////////////////////////////////////////////////////////////
 class HistoryAnalyzer final
 {
@@ -39,12 +53,12 @@ class HistoryAnalyzer final
     ////////////////////////////////////////////////////////////////////////////
     // Simple data struct to represent a data point
     // 
-    // - String for date, as we don't need to manipulate it
-    // - float Price
+    // - Timestamp in seconds since epoch, see DateTime for formatting it
+    // - double Price
     ////////////////////////////////////////////////////////////////////////////
     struct DataPoint
     {
-        std::string date;
+        std::int64_t time;
         double price;
     };
 
@@ -68,17 +82,79 @@ class HistoryAnalyzer final
         double      standardDeviation;
     };
 
-    // Get the stored datapoints
-    const std::vector<DataPoint>& getDataPoints() const;
+    // Number of stored datapoints
+    std::size_t size() const;
+
+    // Get a stored datapoint
+    DataPoint getDataPoint(std::size_t index) const;
+
+    // Get the stored timestamps and prices
+    const AlignedVector<std::int64_t>& getTimes() const;
+    const AlignedVector<double>& getPrices() const;
 
     // Analyze and return the stats
+    // Safe to call from several threads at once, as long as nothing modifies
+    // the data at the same time
     const Stats analyze() const;
 
+    // Analyze only the data from..to inclusive, by filtering the range
+    // rather than building a HistoryIndex, for answering a single query
+    // Returns nothing if there's no data in the range
+    optional<Stats> analyze(std::int64_t from, std::int64_t to) const;
+
+    // Append a data point to the end of the series
+    // Returns false if it isn't later than the last data point
+    bool append(std::int64_t time, double price);
+
+    // As above, with the date as a string
+    // Returns false if the date is invalid
+    bool append(std::string_view date, double price);
+
+    // Replace the data, sorting it into chronological order if needed
+    void assign(AlignedVector<std::int64_t> times, AlignedVector<double> prices);
+
+    // Changes whenever the data does, and is never the same for two different
+    // sets of data, so results computed from the data can tell they're stale
+    std::uint64_t generation() const;
+
+    // Set how many threads analyze() may use, 0 meaning one per core
+    void setThreadCount(unsigned threads);
+
     // Parse the json
     // Returns false if failure
-    bool parse(nlohmann::json json);
+    bool parse(const nlohmann::json& json);
+
+    // Parse raw json text without building a json document
+    // Returns false if failure
+    bool parse(const char* data, std::size_t size);
+    bool parse(std::istream& stream);
 
     private:
-    std::vector<DataPoint> m_dataPoints = {};
+
+    // Stats kept between calls to analyze() and updated by append()
+    struct Summary
+    {
+        StatsAccumulator    accumulator;
+        double              median = 0.;
+
+        // Only built once data is appended after analysis
+        MedianTracker       medianTracker;
+        bool                tracking = false;
+    };
+
+    // Build the summary from scratch, the summary mutex must be held
+    void summarize() const;
+
+    // Reduce prices [begin, end) to an accumulator and a median, splitting
+    // the work over threads
+    void reduce(std::size_t begin, std::size_t end, StatsAccumulator& accumulator, double& median) const;
+
+    AlignedVector<std::int64_t> m_times = {};
+    AlignedVector<double>       m_prices = {};
+    unsigned                    m_threadCount = 1;
+    std::uint64_t               m_generation = 0;
+
+    mutable std::mutex                  m_summaryMutex;
+    mutable std::unique_ptr<Summary>    m_summary;
 
 };
\ No newline at end of file
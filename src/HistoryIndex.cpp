@@ -0,0 +1,313 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "HistoryIndex.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+    // Prices per sparse table block. Queries scan at most two partial
+    // blocks, so this trades a little query time for a table 1/BlockSize
+    // the size of a plain sparse table
+    constexpr std::size_t BlockSize = 32;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistoryIndex::HistoryIndex(const HistoryAnalyzer& analyzer) :
+m_analyzer(analyzer),
+m_size(analyzer.size())
+{
+    Profiler::Scope scope("index");
+
+    auto& prices = m_analyzer.getPrices();
+
+    // Leaves are padded out to a power of two with empty states
+    auto blocks = (m_size + BlockSize - 1) / BlockSize;
+    m_leaves = 1;
+    while (m_leaves < blocks)
+    {
+        m_leaves *= 2;
+    }
+
+    m_blockStats.resize(2 * m_leaves);
+    for (std::size_t block = 0; block < blocks; ++block)
+    {
+        auto begin = block * BlockSize;
+        auto end = std::min(begin + BlockSize, m_size);
+        m_blockStats[m_leaves + block].add(prices.data() + begin, end - begin, begin);
+    }
+    for (auto node = m_leaves - 1; node > 0; --node)
+    {
+        m_blockStats[node] = m_blockStats[2 * node];
+        m_blockStats[node].merge(m_blockStats[2 * node + 1]);
+    }
+
+    buildTable(m_lowest, [this](std::size_t a, std::size_t b) { return lower(a, b); });
+    buildTable(m_highest, [this](std::size_t a, std::size_t b) { return higher(a, b); });
+
+    // Compress prices to ranks among the distinct prices, so the matrix only
+    // needs as many levels as there are bits in the number of distinct prices
+    m_distinct.assign(prices.begin(), prices.begin() + m_size);
+    std::sort(m_distinct.begin(), m_distinct.end());
+    m_distinct.erase(std::unique(m_distinct.begin(), m_distinct.end()), m_distinct.end());
+
+    std::vector<std::uint32_t> ranks(m_size);
+    for (std::size_t i = 0; i < m_size; ++i)
+    {
+        ranks[i] = static_cast<std::uint32_t>(
+            std::lower_bound(m_distinct.begin(), m_distinct.end(), prices[i]) - m_distinct.begin());
+    }
+
+    unsigned bits = 0;
+    while (bits < 32 && (std::size_t(1) << bits) < m_distinct.size())
+    {
+        ++bits;
+    }
+    m_ranks = WaveletMatrix(std::move(ranks), bits);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<HistoryAnalyzer::Stats> HistoryIndex::query(std::int64_t from, std::int64_t to) const
+{
+    std::size_t begin, end;
+    positions(from, to, begin, end);
+
+    if (begin >= end)
+    {
+        return {};
+    }
+    return optional<HistoryAnalyzer::Stats>(queryPositions(begin, end));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistoryAnalyzer::Stats HistoryIndex::queryPositions(std::size_t begin, std::size_t end) const
+{
+    HistoryAnalyzer::Stats stats = {};
+    stats.dataSize = end - begin;
+
+    StatsAccumulator accumulator;
+    accumulate(begin, end, accumulator);
+    stats.meanPrice = accumulator.mean();
+    stats.standardDeviation = accumulator.standardDeviation();
+
+    stats.lowest = m_analyzer.getDataPoint(
+        rangeBest(m_lowest, begin, end, [this](std::size_t a, std::size_t b) { return lower(a, b); }));
+    stats.highest = m_analyzer.getDataPoint(
+        rangeBest(m_highest, begin, end, [this](std::size_t a, std::size_t b) { return higher(a, b); }));
+
+    stats.medianPrice = median(begin, end);
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<double> HistoryIndex::quantile(std::int64_t from, std::int64_t to, double q) const
+{
+    std::size_t begin, end;
+    positions(from, to, begin, end);
+
+    if (begin >= end)
+    {
+        return {};
+    }
+
+    q = std::min(std::max(q, 0.), 1.);
+    auto position = q * static_cast<double>(end - begin - 1);
+    auto lowerRank = static_cast<std::size_t>(position);
+    auto fraction = position - static_cast<double>(lowerRank);
+
+    auto value = kthSmallest(begin, end, lowerRank);
+    if (fraction > 0.)
+    {
+        value += (kthSmallest(begin, end, lowerRank + 1) - value) * fraction;
+    }
+    return optional<double>(value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double HistoryIndex::kthSmallest(std::size_t begin, std::size_t end, std::size_t k) const
+{
+    return m_distinct[m_ranks.kthSmallest(begin, end, k)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double HistoryIndex::median(std::size_t begin, std::size_t end) const
+{
+    auto count = end - begin;
+    auto upper = kthSmallest(begin, end, count / 2);
+    if (count % 2)
+    {
+        return upper;
+    }
+    return (kthSmallest(begin, end, count / 2 - 1) + upper) / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryIndex::positions(std::int64_t from, std::int64_t to, std::size_t& begin, std::size_t& end) const
+{
+    auto& times = m_analyzer.getTimes();
+    auto first = times.begin();
+    auto last = times.begin() + m_size;
+
+    begin = std::lower_bound(first, last, from) - first;
+    end = std::upper_bound(first, last, to) - first;
+    end = std::max(begin, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryIndex::accumulate(std::size_t begin, std::size_t end, StatsAccumulator& accumulator) const
+{
+    auto& prices = m_analyzer.getPrices();
+
+    // Whole blocks covered by the range
+    auto firstBlock = (begin + BlockSize - 1) / BlockSize;
+    auto lastBlock = end / BlockSize;
+
+    if (firstBlock >= lastBlock)
+    {
+        accumulator.add(prices.data() + begin, end - begin, begin);
+        return;
+    }
+
+    // Partial blocks at either end
+    accumulator.add(prices.data() + begin, firstBlock * BlockSize - begin, begin);
+    accumulator.add(prices.data() + lastBlock * BlockSize, end - lastBlock * BlockSize, lastBlock * BlockSize);
+
+    // Climb the tree from both ends, merging the nodes that fall inside
+    for (auto left = firstBlock + m_leaves, right = lastBlock + m_leaves; left < right; left /= 2, right /= 2)
+    {
+        if (left % 2)
+        {
+            accumulator.merge(m_blockStats[left++]);
+        }
+        if (right % 2)
+        {
+            accumulator.merge(m_blockStats[--right]);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t HistoryIndex::lower(std::size_t a, std::size_t b) const
+{
+    auto& prices = m_analyzer.getPrices();
+    if (prices[b] < prices[a] || (prices[b] == prices[a] && b < a))
+    {
+        return b;
+    }
+    return a;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t HistoryIndex::higher(std::size_t a, std::size_t b) const
+{
+    auto& prices = m_analyzer.getPrices();
+    if (prices[b] > prices[a] || (prices[b] == prices[a] && b < a))
+    {
+        return b;
+    }
+    return a;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template<class Better>
+void HistoryIndex::buildTable(SparseTable& table, Better better)
+{
+    auto blocks = (m_size + BlockSize - 1) / BlockSize;
+    if (!blocks)
+    {
+        return;
+    }
+
+    // Level zero is the best of each block
+    table.levels.emplace_back(blocks);
+    for (std::size_t block = 0; block < blocks; ++block)
+    {
+        auto begin = block * BlockSize;
+        auto end = std::min(begin + BlockSize, m_size);
+        auto best = begin;
+        for (auto i = begin + 1; i < end; ++i)
+        {
+            best = better(best, i);
+        }
+        table.levels[0][block] = best;
+    }
+
+    // Each level after covers twice as many blocks as the one before
+    for (std::size_t width = 2; width <= blocks; width *= 2)
+    {
+        auto& previous = table.levels.back();
+        std::vector<std::size_t> level(blocks - width + 1);
+        for (std::size_t block = 0; block < level.size(); ++block)
+        {
+            level[block] = better(previous[block], previous[block + width / 2]);
+        }
+        table.levels.push_back(std::move(level));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template<class Better>
+std::size_t HistoryIndex::rangeBest(const SparseTable& table, std::size_t begin, std::size_t end, Better better) const
+{
+    auto best = begin;
+
+    // Whole blocks covered by the range
+    auto firstBlock = (begin + BlockSize - 1) / BlockSize;
+    auto lastBlock = end / BlockSize;
+
+    if (firstBlock >= lastBlock)
+    {
+        // Too short to cover a whole block, just scan it
+        for (auto i = begin + 1; i < end; ++i)
+        {
+            best = better(best, i);
+        }
+        return best;
+    }
+
+    // Partial blocks at either end
+    for (auto i = begin + 1; i < firstBlock * BlockSize; ++i)
+    {
+        best = better(best, i);
+    }
+    for (auto i = lastBlock * BlockSize; i < end; ++i)
+    {
+        best = better(best, i);
+    }
+
+    // Two overlapping powers of two cover the whole blocks
+    auto blocks = lastBlock - firstBlock;
+    std::size_t level = 0;
+    while ((std::size_t(2) << level) <= blocks)
+    {
+        ++level;
+    }
+
+    auto& row = table.levels[level];
+    best = better(best, row[firstBlock]);
+    best = better(best, row[lastBlock - (std::size_t(1) << level)]);
+    return best;
+}
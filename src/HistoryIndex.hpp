@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "HistoryAnalyzer.hpp"
+#include "Optional.hpp"
+#include "StatsAccumulator.hpp"
+#include "WaveletMatrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// Index over a loaded series for O(log n) date range queries
+//
+// Holds a tree of StatsAccumulator states over blocks of prices for the
+// count, mean and standard deviation. A range merges the O(log n) states
+// covering it, which stays accurate however far its prices are from the
+// rest of the series, where differences of prefix sums wouldn't. A block
+// sparse table gives the highest and lowest prices. Medians and other
+// quantiles come from a wavelet matrix over the prices' ranks, in O(log n)
+// without copying the range.
+//
+// The index refers to the analyzer's data, so it must not outlive it, and has
+// to be rebuilt once the analyzer's data changes
+////////////////////////////////////////////////////////////////////////////////
+class HistoryIndex final
+{
+    public:
+    HistoryIndex(const HistoryAnalyzer& analyzer);
+
+    // Stats for data points with from <= time <= to
+    // Returns nothing if there are no data points in the range
+    optional<HistoryAnalyzer::Stats> query(std::int64_t from, std::int64_t to) const;
+
+    // The q quantile (0 <= q <= 1) of prices with from <= time <= to,
+    // interpolating linearly between the closest ranks
+    // Returns nothing if there are no data points in the range
+    optional<double> quantile(std::int64_t from, std::int64_t to, double q) const;
+
+    // Stats for data points at positions [begin, end), which must not be empty
+    HistoryAnalyzer::Stats queryPositions(std::size_t begin, std::size_t end) const;
+
+    // The k-th (zero based) smallest price at positions [begin, end)
+    double kthSmallest(std::size_t begin, std::size_t end, std::size_t k) const;
+
+    // The median price at positions [begin, end), which must not be empty
+    double median(std::size_t begin, std::size_t end) const;
+
+    // Positions [begin, end) of the data points with from <= time <= to
+    void positions(std::int64_t from, std::int64_t to, std::size_t& begin, std::size_t& end) const;
+
+    private:
+    // Sparse table over block minimums or maximums
+    struct SparseTable
+    {
+        std::vector<std::vector<std::size_t>> levels;
+    };
+
+    // Index of the better of two data points, the earliest winning ties
+    std::size_t lower(std::size_t a, std::size_t b) const;
+    std::size_t higher(std::size_t a, std::size_t b) const;
+
+    // Index of the lowest or highest price in positions [begin, end)
+    template<class Better>
+    std::size_t rangeBest(const SparseTable& table, std::size_t begin, std::size_t end, Better better) const;
+
+    template<class Better>
+    void buildTable(SparseTable& table, Better better);
+
+    // Accumulate the prices at positions [begin, end)
+    void accumulate(std::size_t begin, std::size_t end, StatsAccumulator& accumulator) const;
+
+    const HistoryAnalyzer&  m_analyzer;
+    const std::size_t       m_size;
+
+    // Binary tree of the states of each block, the leaves starting at
+    // m_leaves and each node above merging its two children
+    std::size_t                     m_leaves = 0;
+    std::vector<StatsAccumulator>   m_blockStats;
+
+    SparseTable             m_lowest;
+    SparseTable             m_highest;
+
+    // Distinct prices in ascending order, and the matrix over each price's
+    // position in them
+    std::vector<double>     m_distinct;
+    WaveletMatrix           m_ranks;
+};
@@ -0,0 +1,601 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "HistoryParser.hpp"
+
+namespace
+{
+    // Limit on nesting of skipped values, so bad input can't blow the stack
+    constexpr int MaxDepth = 256;
+
+    // Size of the read buffer used for streams
+    constexpr std::size_t StreamBufferSize = 64 * 1024;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Helpers shared by both input types
+    ////////////////////////////////////////////////////////////////////////////
+    inline bool isStringEnd(char c)
+    {
+        return c == '"' || c == '\\';
+    }
+
+    inline bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // Whether text is a json number, -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    // Conversions accept more than that, like "+1", "01", ".5", "inf" or hex
+    bool isNumber(const char* begin, const char* end)
+    {
+        auto c = begin;
+        if (c != end && *c == '-')
+        {
+            ++c;
+        }
+
+        if (c == end || !isDigit(*c))
+        {
+            return false;
+        }
+        if (*c++ != '0')
+        {
+            for (; c != end && isDigit(*c); ++c);
+        }
+
+        if (c != end && *c == '.')
+        {
+            if (++c == end || !isDigit(*c))
+            {
+                return false;
+            }
+            for (; c != end && isDigit(*c); ++c);
+        }
+
+        if (c != end && (*c == 'e' || *c == 'E'))
+        {
+            if (++c != end && (*c == '+' || *c == '-'))
+            {
+                ++c;
+            }
+            if (c == end || !isDigit(*c))
+            {
+                return false;
+            }
+            for (; c != end && isDigit(*c); ++c);
+        }
+        return c == end;
+    }
+
+    template<class Input>
+    bool readHex4(Input& input, unsigned& out)
+    {
+        out = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto c = input.get();
+            out <<= 4;
+            if (c >= '0' && c <= '9')      out |= static_cast<unsigned>(c - '0');
+            else if (c >= 'a' && c <= 'f') out |= static_cast<unsigned>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') out |= static_cast<unsigned>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    void appendUtf8(std::string& out, unsigned codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    // Decode a single escape sequence, the backslash has already been consumed
+    template<class Input>
+    bool readEscape(Input& input, std::string& out)
+    {
+        switch (input.get())
+        {
+            case '"':  out += '"';  return true;
+            case '\\': out += '\\'; return true;
+            case '/':  out += '/';  return true;
+            case 'b':  out += '\b'; return true;
+            case 'f':  out += '\f'; return true;
+            case 'n':  out += '\n'; return true;
+            case 'r':  out += '\r'; return true;
+            case 't':  out += '\t'; return true;
+            case 'u':
+            {
+                unsigned codePoint;
+                if (!readHex4(input, codePoint))
+                {
+                    return false;
+                }
+
+                // Surrogate pairs come as two escapes
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+                {
+                    unsigned low;
+                    if (input.get() != '\\' || input.get() != 'u' ||
+                        !readHex4(input, low) || low < 0xDC00 || low > 0xDFFF)
+                    {
+                        return false;
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, codePoint);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Input over a contiguous block of memory
+    //
+    // Strings without escapes are returned as views straight into the input
+    ////////////////////////////////////////////////////////////////////////////
+    class MemoryInput final
+    {
+        public:
+        MemoryInput(const char* data, std::size_t size) :
+        m_pos(data),
+        m_end(data + size) {}
+
+        int peek() const
+        {
+            return m_pos != m_end ? static_cast<unsigned char>(*m_pos) : EOF;
+        }
+
+        int get()
+        {
+            return m_pos != m_end ? static_cast<unsigned char>(*m_pos++) : EOF;
+        }
+
+        // Read the rest of a string, the opening quote has already been consumed
+        bool readString(std::string& scratch, std::string_view& out)
+        {
+            auto start = m_pos;
+            scan();
+
+            if (m_pos == m_end)
+            {
+                return false;
+            }
+
+            // Fast path, no escapes
+            if (*m_pos == '"')
+            {
+                out = std::string_view(start, static_cast<std::size_t>(m_pos++ - start));
+                return true;
+            }
+
+            scratch.assign(start, m_pos);
+            for (;;)
+            {
+                ++m_pos; // Backslash
+                if (!readEscape(*this, scratch))
+                {
+                    return false;
+                }
+
+                start = m_pos;
+                scan();
+                scratch.append(start, m_pos);
+
+                if (m_pos == m_end)
+                {
+                    return false;
+                }
+
+                if (*m_pos == '"')
+                {
+                    ++m_pos;
+                    out = scratch;
+                    return true;
+                }
+            }
+        }
+
+        private:
+        void scan()
+        {
+            while (m_pos != m_end && !isStringEnd(*m_pos))
+            {
+                ++m_pos;
+            }
+        }
+
+        const char* m_pos;
+        const char* const m_end;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Input over a stream, read in fixed size blocks
+    //
+    // Strings are always copied, as the buffer may be refilled before the
+    // caller is done with them
+    ////////////////////////////////////////////////////////////////////////////
+    class StreamInput final
+    {
+        public:
+        StreamInput(std::istream& stream) :
+        m_stream(stream),
+        m_buffer(StreamBufferSize) {}
+
+        int peek()
+        {
+            if (m_pos == m_end && !refill())
+            {
+                return EOF;
+            }
+            return static_cast<unsigned char>(*m_pos);
+        }
+
+        int get()
+        {
+            if (m_pos == m_end && !refill())
+            {
+                return EOF;
+            }
+            return static_cast<unsigned char>(*m_pos++);
+        }
+
+        // Read the rest of a string, the opening quote has already been consumed
+        bool readString(std::string& scratch, std::string_view& out)
+        {
+            scratch.clear();
+            for (;;)
+            {
+                if (m_pos == m_end && !refill())
+                {
+                    return false;
+                }
+
+                auto start = m_pos;
+                while (m_pos != m_end && !isStringEnd(*m_pos))
+                {
+                    ++m_pos;
+                }
+                scratch.append(start, m_pos);
+
+                if (m_pos == m_end)
+                {
+                    continue;
+                }
+
+                if (*m_pos++ == '"')
+                {
+                    out = scratch;
+                    return true;
+                }
+
+                if (!readEscape(*this, scratch))
+                {
+                    return false;
+                }
+            }
+        }
+
+        private:
+        bool refill()
+        {
+            m_stream.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            auto count = static_cast<std::size_t>(m_stream.gcount());
+            m_pos = m_buffer.data();
+            m_end = m_pos + count;
+            return count > 0;
+        }
+
+        std::istream&       m_stream;
+        std::vector<char>   m_buffer;
+        const char*         m_pos = nullptr;
+        const char*         m_end = nullptr;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Recursive descent parser, generic over the input type
+    ////////////////////////////////////////////////////////////////////////////
+    template<class Input>
+    class Parser final
+    {
+        public:
+        Parser(Input& input, const HistoryParser::Callback& callback) :
+        m_input(input),
+        m_callback(callback) {}
+
+        bool parse()
+        {
+            skipWhitespace();
+            if (m_input.peek() != '{')
+            {
+                std::cout << "bpi data not found in json" << std::endl;
+                return false;
+            }
+
+            bool found = false;
+            auto ok = parseObject(m_key, [this, &found](std::string_view key)
+            {
+                if (key == "bpi")
+                {
+                    found = true;
+                    return parseBpi();
+                }
+                return skipValue(0);
+            });
+
+            // Nothing but whitespace allowed after the document
+            skipWhitespace();
+            if (!ok || m_input.peek() != EOF)
+            {
+                std::cout << "Error parsing json, please check data is correct" << std::endl;
+                return false;
+            }
+
+            if (!found)
+            {
+                std::cout << "bpi data not found in json" << std::endl;
+                return false;
+            }
+
+            return true;
+        }
+
+        private:
+        void skipWhitespace()
+        {
+            for (;;)
+            {
+                auto c = m_input.peek();
+                if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+                {
+                    return;
+                }
+                m_input.get();
+            }
+        }
+
+        // Parse an object, calling the handler to parse the value of each member
+        template<class Handler>
+        bool parseObject(std::string& scratch, Handler&& handler)
+        {
+            m_input.get(); // Opening brace
+            skipWhitespace();
+            if (m_input.peek() == '}')
+            {
+                m_input.get();
+                return true;
+            }
+
+            for (;;)
+            {
+                std::string_view key;
+                skipWhitespace();
+                if (m_input.get() != '"' || !m_input.readString(scratch, key))
+                {
+                    return false;
+                }
+
+                skipWhitespace();
+                if (m_input.get() != ':')
+                {
+                    return false;
+                }
+
+                skipWhitespace();
+                if (!handler(key))
+                {
+                    return false;
+                }
+
+                skipWhitespace();
+                auto c = m_input.get();
+                if (c == '}')
+                {
+                    return true;
+                }
+                if (c != ',')
+                {
+                    return false;
+                }
+            }
+        }
+
+        bool parseBpi()
+        {
+            if (m_input.peek() != '{')
+            {
+                return false;
+            }
+
+            return parseObject(m_date, [this](std::string_view date)
+            {
+                double price;
+                if (!readNumber(price))
+                {
+                    return false;
+                }
+                m_callback(date, price);
+                return true;
+            });
+        }
+
+        bool readNumber(double& out)
+        {
+            char buffer[64];
+            std::size_t length = 0;
+
+            for (auto c = m_input.peek();
+                (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+                c = m_input.peek())
+            {
+                if (length == sizeof(buffer) - 1)
+                {
+                    return false;
+                }
+                buffer[length++] = static_cast<char>(m_input.get());
+            }
+
+            if (!isNumber(buffer, buffer + length))
+            {
+                return false;
+            }
+
+#if defined(BCSTATS_HAS_FLOAT_FROM_CHARS)
+            // Always a '.' for the decimal point, whatever the locale
+            auto result = std::from_chars(buffer, buffer + length, out);
+            return result.ec == std::errc() && result.ptr == buffer + length;
+#else
+            // Only valid json numbers get here, which strtod reads the same
+            // way as long as the locale's decimal point is '.'
+            buffer[length] = '\0';
+            char* end;
+            out = std::strtod(buffer, &end);
+            return end == buffer + length && std::isfinite(out);
+#endif
+        }
+
+        bool readLiteral(const char* literal)
+        {
+            for (; *literal; ++literal)
+            {
+                if (m_input.get() != *literal)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool skipValue(int depth)
+        {
+            if (depth > MaxDepth)
+            {
+                return false;
+            }
+
+            std::string_view unused;
+            switch (m_input.peek())
+            {
+                case '{':
+                    return parseObject(m_skip, [this, depth](std::string_view)
+                    {
+                        return skipValue(depth + 1);
+                    });
+                case '[':
+                {
+                    m_input.get();
+                    skipWhitespace();
+                    if (m_input.peek() == ']')
+                    {
+                        m_input.get();
+                        return true;
+                    }
+                    for (;;)
+                    {
+                        skipWhitespace();
+                        if (!skipValue(depth + 1))
+                        {
+                            return false;
+                        }
+                        skipWhitespace();
+                        auto c = m_input.get();
+                        if (c == ']')
+                        {
+                            return true;
+                        }
+                        if (c != ',')
+                        {
+                            return false;
+                        }
+                    }
+                }
+                case '"':
+                    m_input.get();
+                    return m_input.readString(m_skip, unused);
+                case 't':
+                    return readLiteral("true");
+                case 'f':
+                    return readLiteral("false");
+                case 'n':
+                    return readLiteral("null");
+                default:
+                {
+                    double number;
+                    return readNumber(number);
+                }
+            }
+        }
+
+        Input&                          m_input;
+        const HistoryParser::Callback&  m_callback;
+
+        // Separate scratch space for each kind of string, so views stay valid
+        std::string                     m_key;
+        std::string                     m_date;
+        std::string                     m_skip;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryParser::parse(const char* data, std::size_t size, const Callback& callback)
+{
+    MemoryInput input(data, size);
+    return Parser<MemoryInput>(input, callback).parse();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryParser::parse(std::istream& stream, const Callback& callback)
+{
+    StreamInput input(stream);
+    return Parser<StreamInput>(input, callback).parse();
+}
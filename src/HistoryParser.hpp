@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <string_view>
+
+////////////////////////////////////////////////////////////////////////////////
+// Streaming parser for coindesk style json history data
+//
+// Reads the "bpi" object straight from the bytes, handing each date/price pair
+// to a callback, so no json document is ever built. Everything outside of
+// "bpi" is validated and skipped.
+////////////////////////////////////////////////////////////////////////////////
+class HistoryParser final
+{
+    public:
+
+    // Called for every entry in "bpi", in document order. The date view is
+    // only valid for the duration of the call
+    using Callback = std::function<void(std::string_view date, double price)>;
+
+    // Parse json held in memory
+    // Returns false if failure
+    static bool parse(const char* data, std::size_t size, const Callback& callback);
+
+    // Parse json read from a stream
+    // Returns false if failure
+    static bool parse(std::istream& stream, const Callback& callback);
+};
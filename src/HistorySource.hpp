@@ -24,18 +24,13 @@
 
 #pragma once
 
+#include <string>
+
 #include <json/json.hpp>
 
-// Windows doesn't use experimental, so use correct include and create an alias
-#if defined(WIN32)
-    #include <optional>
-    template<class T>
-    using optional = std::optional<T>;
-#else
-    #include <experimental/optional>
-    template<class T>
-    using optional = std::experimental::optional<T>;
-#endif
+#include "Optional.hpp"
+
+class HistoryAnalyzer;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Base interface class for history sources
@@ -43,7 +38,17 @@
 class HistorySource
 {
     public:
+    virtual ~HistorySource() = default;
     
     // Get the json history data
     virtual const optional<nlohmann::json> get() const = 0;
+
+    // Parse the history data straight into the analyzer, without building
+    // a json document first
+    // Returns false if failure
+    virtual bool read(HistoryAnalyzer& analyzer) const = 0;
+
+    // Identifies where the history comes from, so results computed from it
+    // can be cached
+    virtual std::string identity() const = 0;
 };
\ No newline at end of file
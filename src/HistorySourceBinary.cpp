@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "DateTime.hpp"
+#include "HistoryAnalyzer.hpp"
+#include "HistorySourceBinary.hpp"
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+    constexpr char Magic[8] = {'B', 'C', 'H', 'I', 'S', 'T', 'B', '1'};
+    constexpr std::uint32_t Version = 1;
+    constexpr std::uint64_t Alignment = 64;
+
+    static_assert(sizeof(HistorySourceBinary::Header) == 64, "Header must be 64 bytes");
+
+    // Units times can be keyed in, coarsest first
+    constexpr std::int64_t Units[] = {DateTime::SecondsPerDay, 3600, 60, 1};
+
+    // Furthest a key can take a time from the base time, so a base time
+    // this far inside the int64 range can't overflow
+    constexpr std::int64_t MaxSpan = (std::int64_t(std::numeric_limits<std::int32_t>::max()) + 1) * DateTime::SecondsPerDay;
+
+    std::uint64_t alignUp(std::uint64_t offset)
+    {
+        return (offset + Alignment - 1) / Alignment * Alignment;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistorySourceBinary::HistorySourceBinary(const std::string& path) :
+HistorySource(),
+m_filePath(path),
+m_file(std::make_unique<MappedFile>(path))
+{
+    if (!m_file->isOpen() || m_file->size() < sizeof(Header))
+    {
+        return;
+    }
+
+    auto& h = header();
+    if (std::memcmp(h.magic, Magic, sizeof(Magic)) || h.version != Version
+        || std::find(std::begin(Units), std::end(Units), h.unit) == std::end(Units)
+        || h.baseTime > std::numeric_limits<std::int64_t>::max() - MaxSpan
+        || h.baseTime < std::numeric_limits<std::int64_t>::min() + MaxSpan)
+    {
+        return;
+    }
+
+    // Both columns have to fit in the file, and be aligned for their types
+    auto size = static_cast<std::uint64_t>(m_file->size());
+    auto count = h.count;
+    if (h.keysOffset % alignof(std::int32_t) || h.pricesOffset % alignof(double)
+        || count > size / sizeof(double)
+        || h.keysOffset > size || count * sizeof(std::int32_t) > size - h.keysOffset
+        || h.pricesOffset > size || count * sizeof(double) > size - h.pricesOffset)
+    {
+        return;
+    }
+    m_valid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistorySourceBinary::~HistorySourceBinary() = default;
+
+////////////////////////////////////////////////////////////////////////////////
+const optional<nlohmann::json> HistorySourceBinary::get() const
+{
+    HistoryAnalyzer analyzer;
+    if (!read(analyzer))
+    {
+        return {};
+    }
+
+    nlohmann::json json;
+    auto& bpi = json["bpi"];
+    for (std::size_t i = 0; i < analyzer.size(); ++i)
+    {
+        auto p = analyzer.getDataPoint(i);
+        bpi[DateTime::format(p.time)] = p.price;
+    }
+    return optional<nlohmann::json>(std::move(json));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceBinary::read(HistoryAnalyzer& analyzer) const
+{
+    Profiler::Scope scope("load binary");
+
+    if (!m_valid)
+    {
+        std::cout << "Failed to open binary history file at " << m_filePath << std::endl;
+        return false;
+    }
+
+    auto& h = header();
+    auto count = static_cast<std::size_t>(h.count);
+    auto k = keys();
+
+    AlignedVector<std::int64_t> times(count);
+    if (h.flags & DeltaKeys)
+    {
+        // Keys are only known to be in range once they're summed
+        std::int64_t key = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            key += k[i];
+            if (key < std::numeric_limits<std::int32_t>::min() || key > std::numeric_limits<std::int32_t>::max())
+            {
+                std::cout << "Corrupt keys in binary history file at " << m_filePath << std::endl;
+                return false;
+            }
+            times[i] = h.baseTime + key * h.unit;
+        }
+    }
+    else
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            times[i] = h.baseTime + static_cast<std::int64_t>(k[i]) * h.unit;
+        }
+    }
+
+    // Checked as they're copied, as parsing text checks them
+    auto column = prices();
+    AlignedVector<double> values(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (!std::isfinite(column[i]))
+        {
+            std::cout << "Corrupt prices in binary history file at " << m_filePath << std::endl;
+            return false;
+        }
+        values[i] = column[i];
+    }
+
+    analyzer.assign(std::move(times), std::move(values));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string HistorySourceBinary::identity() const
+{
+    return "file:" + m_filePath;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceBinary::isOpen() const
+{
+    return m_valid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const HistorySourceBinary::Header& HistorySourceBinary::header() const
+{
+    return *reinterpret_cast<const Header*>(m_file->data());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const std::int32_t* HistorySourceBinary::keys() const
+{
+    return reinterpret_cast<const std::int32_t*>(m_file->data() + header().keysOffset);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const double* HistorySourceBinary::prices() const
+{
+    return reinterpret_cast<const double*>(m_file->data() + header().pricesOffset);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceBinary::write(const std::string& path, const HistoryAnalyzer& analyzer, bool delta)
+{
+    auto& times = analyzer.getTimes();
+    auto count = analyzer.size();
+
+    Header h = {};
+    std::memcpy(h.magic, Magic, sizeof(Magic));
+    h.version = Version;
+    h.flags = delta ? DeltaKeys : 0;
+    h.count = count;
+    h.baseTime = count ? times[0] : 0;
+
+    // The coarsest unit every timestamp is a whole number of, so daily data
+    // is keyed by day and intraday data by hour, minute or second
+    h.unit = 0;
+    for (auto unit : Units)
+    {
+        bool whole = true;
+        for (std::size_t i = 0; i < count && whole; ++i)
+        {
+            whole = (times[i] - h.baseTime) % unit == 0;
+        }
+        if (whole)
+        {
+            h.unit = unit;
+            break;
+        }
+    }
+
+    // Data is chronological, so the last key is the largest, and with delta
+    // encoding no step can be larger than it
+    if (count && (times[count - 1] - h.baseTime) / h.unit > std::numeric_limits<std::int32_t>::max())
+    {
+        std::cout << "History spans too long to write as binary" << std::endl;
+        return false;
+    }
+
+    std::vector<std::int32_t> keys(count);
+    std::int64_t previous = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto key = (times[i] - h.baseTime) / h.unit;
+        keys[i] = static_cast<std::int32_t>(delta ? key - previous : key);
+        previous = key;
+    }
+
+    h.keysOffset = sizeof(Header);
+    h.pricesOffset = alignUp(h.keysOffset + count * sizeof(std::int32_t));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    file.write(reinterpret_cast<const char*>(keys.data()),
+        static_cast<std::streamsize>(count * sizeof(std::int32_t)));
+
+    const char padding[Alignment] = {};
+    file.write(padding, static_cast<std::streamsize>(h.pricesOffset - h.keysOffset - count * sizeof(std::int32_t)));
+    file.write(reinterpret_cast<const char*>(analyzer.getPrices().data()),
+        static_cast<std::streamsize>(count * sizeof(double)));
+
+    if (!file)
+    {
+        std::cout << "Failed to write binary history file at " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceBinary::isBinary(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(Magic)];
+    return file.read(magic, sizeof(magic)) && !std::memcmp(magic, Magic, sizeof(Magic));
+}
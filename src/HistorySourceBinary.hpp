@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "HistorySource.hpp"
+
+class MappedFile;
+
+////////////////////////////////////////////////////////////////////////////////
+// History source for the binary columnar format, read through a memory map
+//
+// Layout, in native byte order:
+//
+// - A 64 byte header (see Header)
+// - A column of int32 keys, each time being baseTime + key * unit, or with
+//   delta encoding the difference from the previous key. The unit is a day,
+//   hour, minute or second
+// - A column of float64 prices, starting on a 64 byte boundary
+//
+// Without delta encoding the columns are usable straight from the mapping,
+// and loading is a single pass widening keys to timestamps plus a copy
+////////////////////////////////////////////////////////////////////////////////
+class HistorySourceBinary final : public HistorySource
+{
+    public:
+
+    struct Header
+    {
+        char            magic[8];
+        std::uint32_t   version;
+        std::uint32_t   flags;
+        std::uint64_t   count;
+        std::int64_t    baseTime;
+        std::int64_t    unit;
+        std::uint64_t   keysOffset;
+        std::uint64_t   pricesOffset;
+        std::uint64_t   reserved;
+    };
+
+    // Header flags
+    static constexpr std::uint32_t DeltaKeys = 1;
+
+    HistorySourceBinary(const std::string& path);
+    ~HistorySourceBinary();
+
+    const optional<nlohmann::json> get() const override;
+
+    bool read(HistoryAnalyzer& analyzer) const override;
+
+    std::string identity() const override;
+
+    // Whether the file mapped and has a valid header
+    bool isOpen() const;
+
+    // The header and columns, straight from the mapping, only valid when
+    // the file is open
+    const Header& header() const;
+    const std::int32_t* keys() const;
+    const double* prices() const;
+
+    // Write the analyzer's data in the binary format
+    // Returns false if the timestamps can't be keyed or the file can't be
+    // written
+    static bool write(const std::string& path, const HistoryAnalyzer& analyzer, bool delta = false);
+
+    // Whether a file starts like a binary history file
+    static bool isBinary(const std::string& path);
+
+    private:
+    const std::string           m_filePath;
+    std::unique_ptr<MappedFile> m_file;
+    bool                        m_valid = false;
+};
@@ -25,16 +25,51 @@
 #include <fstream>
 #include <iostream>
 
+#include "DateTime.hpp"
+#include "HistoryAnalyzer.hpp"
 #include "HistorySourceFile.hpp"
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
-HistorySourceFile::HistorySourceFile(const std::string& path) :
+HistorySourceFile::HistorySourceFile(const std::string& path, Mode mode, Format format) :
 HistorySource(),
-m_filePath(path){}
+m_filePath(path),
+m_mode(mode),
+m_format(format){}
 
 ////////////////////////////////////////////////////////////////////////////////
 const optional<nlohmann::json> HistorySourceFile::get() const
 {
+    Profiler::Scope scope("json document");
+
+    if (m_format != Format::JSON)
+    {
+        return decode();
+    }
+
+    if (m_mode == Mode::MemoryMap)
+    {
+        MappedFile file(m_filePath);
+
+        if (!file.isOpen())
+        {
+            std::cout << "Failed to open file at " + m_filePath << std::endl;
+            return {};
+        }
+
+        try
+        {
+            return optional<nlohmann::json>(nlohmann::json::parse(file.data(), file.data() + file.size()));
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << e.what() << std::endl;
+            std::cout << "Error parsing json file, please check file is correct" << std::endl;
+            return {};
+        }
+    }
+
     // Open file
     std::ifstream file(m_filePath);
 
@@ -58,4 +93,161 @@ const optional<nlohmann::json> HistorySourceFile::get() const
     }
 
     return optional<nlohmann::json>(json);
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceFile::read(HistoryAnalyzer& analyzer) const
+{
+    // Binary encodings are decoded into a document first
+    if (m_format != Format::JSON)
+    {
+        auto json = decode();
+        return json && analyzer.parse(*json);
+    }
+
+    if (m_mode == Mode::MemoryMap)
+    {
+        MappedFile file(m_filePath);
+
+        if (!file.isOpen())
+        {
+            std::cout << "Failed to open file at " + m_filePath << std::endl;
+            return false;
+        }
+
+        return analyzer.parse(file.data(), file.size());
+    }
+
+    std::ifstream file(m_filePath, std::ios::binary);
+
+    if (!file.good() || !file.is_open())
+    {
+        std::cout << "Failed to open file at " + m_filePath << std::endl;
+        return false;
+    }
+
+    return analyzer.parse(file);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string HistorySourceFile::identity() const
+{
+    return "file:" + m_filePath;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistorySourceFile::Format HistorySourceFile::formatFromPath(const std::string& path)
+{
+    auto dot = path.rfind('.');
+    Format format = Format::JSON;
+    if (dot != std::string::npos)
+    {
+        parseFormat(path.substr(dot + 1), format);
+    }
+    return format;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceFile::parseFormat(const std::string& name, Format& format)
+{
+    static const std::pair<const char*, Format> names[] =
+    {
+        {"json", Format::JSON},
+        {"cbor", Format::CBOR},
+        {"msgpack", Format::MessagePack},
+        {"ubjson", Format::UBJSON}
+    };
+
+    for (auto& entry : names)
+    {
+        if (name == entry.first)
+        {
+            format = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceFile::write(const std::string& path, const HistoryAnalyzer& analyzer, Format format)
+{
+    nlohmann::json json;
+    auto& bpi = json["bpi"] = nlohmann::json::object();
+    for (std::size_t i = 0; i < analyzer.size(); ++i)
+    {
+        auto p = analyzer.getDataPoint(i);
+        bpi[DateTime::format(p.time)] = p.price;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    switch (format)
+    {
+        case Format::JSON:
+            file << json;
+            break;
+        case Format::CBOR:
+            nlohmann::json::to_cbor(json, file);
+            break;
+        case Format::MessagePack:
+            nlohmann::json::to_msgpack(json, file);
+            break;
+        case Format::UBJSON:
+            nlohmann::json::to_ubjson(json, file);
+            break;
+    }
+
+    if (!file)
+    {
+        std::cout << "Failed to write file at " + path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<nlohmann::json> HistorySourceFile::decode() const
+{
+    Profiler::Scope scope("decode");
+
+    auto decode = [this](auto&&... input)
+    {
+        switch (m_format)
+        {
+            case Format::CBOR:
+                return nlohmann::json::from_cbor(input...);
+            case Format::MessagePack:
+                return nlohmann::json::from_msgpack(input...);
+            default:
+                return nlohmann::json::from_ubjson(input...);
+        }
+    };
+
+    try
+    {
+        if (m_mode == Mode::MemoryMap)
+        {
+            MappedFile file(m_filePath);
+            if (!file.isOpen())
+            {
+                std::cout << "Failed to open file at " + m_filePath << std::endl;
+                return {};
+            }
+            return optional<nlohmann::json>(decode(file.data(), file.size()));
+        }
+
+        std::ifstream file(m_filePath, std::ios::binary);
+        if (!file.good() || !file.is_open())
+        {
+            std::cout << "Failed to open file at " + m_filePath << std::endl;
+            return {};
+        }
+        return optional<nlohmann::json>(decode(file));
+    }
+    catch(const std::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+        std::cout << "Error decoding file, please check file is correct" << std::endl;
+        return {};
+    }
+}
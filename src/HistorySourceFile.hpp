@@ -32,10 +32,47 @@
 class HistorySourceFile final : public HistorySource
 {
     public:
-    HistorySourceFile(const std::string& path);
+
+    // How the file contents are read
+    enum class Mode
+    {
+        Stream,     // Read through an ifstream
+        MemoryMap   // Map the file and parse directly over the mapped bytes
+    };
+
+    // How the history is encoded
+    enum class Format
+    {
+        JSON,           // Text, parsed without building a document
+        CBOR,           // Binary encodings of the same document
+        MessagePack,
+        UBJSON
+    };
+
+    HistorySourceFile(const std::string& path, Mode mode = Mode::Stream, Format format = Format::JSON);
 
     const optional<nlohmann::json> get() const override;
 
+    bool read(HistoryAnalyzer& analyzer) const override;
+
+    std::string identity() const override;
+
+    // Format for a path's extension (.cbor, .msgpack, .ubjson), JSON otherwise
+    static Format formatFromPath(const std::string& path);
+
+    // Format for a name (json, cbor, msgpack, ubjson)
+    // Returns false if the name isn't recognised
+    static bool parseFormat(const std::string& name, Format& format);
+
+    // Write the analyzer's data as a bpi document in the given format
+    // Returns false if the file can't be written
+    static bool write(const std::string& path, const HistoryAnalyzer& analyzer, Format format);
+
     private:
+    // Decode a binary encoded document
+    optional<nlohmann::json> decode() const;
+
     const std::string m_filePath;
+    const Mode        m_mode;
+    const Format      m_format;
 };
\ No newline at end of file
@@ -24,39 +24,77 @@
 
 #include <iostream>
 
+#include "HistoryAnalyzer.hpp"
 #include "HistorySourceHTTP.hpp"
+#include "HTTPCache.hpp"
+#include "HTTPConnectionPool.hpp"
+#include "Profiler.hpp"
 
-#include <http/httplib.hpp>
+////////////////////////////////////////////////////////////////////////////////
+HistorySourceHTTP::HistorySourceHTTP(const std::string& host, const std::string& query, int port) :
+HistorySourceHTTP(host, query, port, HTTPConnectionPool::shared()) {}
 
 ////////////////////////////////////////////////////////////////////////////////
-HistorySourceHTTP::HistorySourceHTTP(const std::string& host, const std::string& query) :
+HistorySourceHTTP::HistorySourceHTTP(const std::string& host, const std::string& query, int port, HTTPConnectionPool& pool) :
 HistorySource(),
 m_host(host),
-m_query(query) {}
+m_query(query),
+m_port(port),
+m_pool(pool) {}
 
 ////////////////////////////////////////////////////////////////////////////////
 const optional<nlohmann::json> HistorySourceHTTP::get() const
 {
-    // Make the http request
-    httplib::Client client(m_host.c_str(), 80);
+    auto body = fetch();
+
+    if (!body)
+    {
+        return {};
+    }
+
+    try
+    {
+        Profiler::Scope scope("json document");
+        return optional<nlohmann::json>(nlohmann::json::parse(*body));
+    }
+    catch (nlohmann::json::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+        std::cout << "HTTP returned " << *body << std::endl;
+        return {};
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceHTTP::read(HistoryAnalyzer& analyzer) const
+{
+    auto body = fetch();
+    return body && analyzer.parse(body->data(), body->size());
+}
 
-    auto res = client.Get(m_query.c_str());
+////////////////////////////////////////////////////////////////////////////////
+std::string HistorySourceHTTP::identity() const
+{
+    return "http://" + m_host + ":" + std::to_string(m_port) + m_query;
+}
 
-    nlohmann::json json;
+////////////////////////////////////////////////////////////////////////////////
+void HistorySourceHTTP::setCache(HTTPCache* cache)
+{
+    m_cache = cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<std::string> HistorySourceHTTP::fetch() const
+{
+    Profiler::Scope scope("fetch");
+
+    // Make the http request, reusing a pooled connection to the host
+    auto res = m_cache ? m_cache->get(m_host, m_port, m_query) : m_pool.get(m_host, m_port, m_query);
 
     if (res && res->status == 200)
     {
-        try
-        {
-            json = nlohmann::json::parse(res->body);
-        }
-        catch (nlohmann::json::exception e)
-        {
-            std::cout << e.what() << std::endl;
-            std::cout << "HTTP returned " << res->body << std::endl;
-            return {};
-        }
-        return json;
+        return optional<std::string>(std::move(res->body));
     }
     else
     {
@@ -70,5 +108,4 @@ const optional<nlohmann::json> HistorySourceHTTP::get() const
         }
         return {};
     }
-    
 }
\ No newline at end of file
@@ -26,17 +26,35 @@
 
 #include "HistorySource.hpp"
 
+class HTTPCache;
+class HTTPConnectionPool;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Class to retreive history data from a web source (likely coindesk)
 ////////////////////////////////////////////////////////////////////////////////
 class HistorySourceHTTP final : public HistorySource
 {
     public:
-    HistorySourceHTTP(const std::string& host, const std::string& query);
+    // Requests go through the given pool, so sources share connections
+    HistorySourceHTTP(const std::string& host, const std::string& query, int port = 80);
+    HistorySourceHTTP(const std::string& host, const std::string& query, int port, HTTPConnectionPool& pool);
 
     const optional<nlohmann::json> get() const override;
 
+    bool read(HistoryAnalyzer& analyzer) const override;
+
+    std::string identity() const override;
+
+    // Make requests through a response cache, or straight to the host if null
+    void setCache(HTTPCache* cache);
+
     private:
+    // Make the request, returning the response body
+    optional<std::string> fetch() const;
+
     const std::string m_host;
     const std::string m_query;
+    const int m_port;
+    HTTPConnectionPool& m_pool;
+    HTTPCache* m_cache = nullptr;
 };
\ No newline at end of file
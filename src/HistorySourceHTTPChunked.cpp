@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <iostream>
+
+#include "DateTime.hpp"
+#include "HistoryAnalyzer.hpp"
+#include "HistorySourceHTTPChunked.hpp"
+#include "HTTPCache.hpp"
+#include "HTTPConnectionPool.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+HistorySourceHTTPChunked::HistorySourceHTTPChunked(const std::string& host, const std::string& path,
+    std::int64_t from, std::int64_t to, unsigned maxInFlight, int port) :
+HistorySourceHTTPChunked(host, path, from, to, maxInFlight, port, HTTPConnectionPool::shared()) {}
+
+////////////////////////////////////////////////////////////////////////////////
+HistorySourceHTTPChunked::HistorySourceHTTPChunked(const std::string& host, const std::string& path,
+    std::int64_t from, std::int64_t to, unsigned maxInFlight, int port, HTTPConnectionPool& pool) :
+HistorySource(),
+m_host(host),
+m_path(path),
+m_from(from),
+m_to(to),
+m_maxInFlight(maxInFlight),
+m_port(port),
+m_pool(pool) {}
+
+////////////////////////////////////////////////////////////////////////////////
+const optional<nlohmann::json> HistorySourceHTTPChunked::get() const
+{
+    HistoryAnalyzer analyzer;
+    if (!read(analyzer))
+    {
+        return {};
+    }
+
+    nlohmann::json json;
+    auto& bpi = json["bpi"];
+    for (std::size_t i = 0; i < analyzer.size(); ++i)
+    {
+        auto p = analyzer.getDataPoint(i);
+        bpi[DateTime::format(p.time)] = p.price;
+    }
+    return optional<nlohmann::json>(std::move(json));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceHTTPChunked::read(HistoryAnalyzer& analyzer) const
+{
+    auto months = splitMonths(m_from, m_to);
+    if (months.empty())
+    {
+        std::cout << "Invalid range for chunked request" << std::endl;
+        return false;
+    }
+
+    // Each month is parsed into its own analyzer by whichever thread fetched it
+    std::vector<HistoryAnalyzer> parts(months.size());
+    std::vector<char> succeeded(months.size(), 0);
+
+    Parallel::forEach(m_maxInFlight, months.size(), [&](std::size_t i)
+    {
+        auto query = m_path + "?start=" + DateTime::format(months[i].first)
+            + "&end=" + DateTime::format(months[i].second);
+
+        std::shared_ptr<httplib::Response> res;
+        {
+            Profiler::Scope scope("fetch");
+            res = m_cache ? m_cache->get(m_host, m_port, query) : m_pool.get(m_host, m_port, query);
+        }
+        if (!res || res->status != 200)
+        {
+            std::cout << "HTTP Error fetching " << query << ": "
+                << (res ? std::to_string(res->status) : std::string("no response")) << std::endl;
+            return;
+        }
+        succeeded[i] = parts[i].parse(res->body.data(), res->body.size());
+    });
+
+    if (std::find(succeeded.begin(), succeeded.end(), 0) != succeeded.end())
+    {
+        return false;
+    }
+
+    // Months don't overlap and are in order, so merging is concatenation
+    Profiler::Scope scope("merge");
+    std::size_t total = 0;
+    for (auto& part : parts)
+    {
+        total += part.size();
+    }
+
+    AlignedVector<std::int64_t> times;
+    AlignedVector<double> prices;
+    times.reserve(total);
+    prices.reserve(total);
+    for (auto& part : parts)
+    {
+        times.insert(times.end(), part.getTimes().begin(), part.getTimes().end());
+        prices.insert(prices.end(), part.getPrices().begin(), part.getPrices().end());
+    }
+
+    analyzer.assign(std::move(times), std::move(prices));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string HistorySourceHTTPChunked::identity() const
+{
+    // The same as a single request for the whole range
+    return "http://" + m_host + ":" + std::to_string(m_port) + m_path
+        + "?start=" + DateTime::format(m_from) + "&end=" + DateTime::format(m_to);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistorySourceHTTPChunked::setCache(HTTPCache* cache)
+{
+    m_cache = cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<std::pair<std::int64_t, std::int64_t>> HistorySourceHTTPChunked::splitMonths(std::int64_t from, std::int64_t to)
+{
+    std::vector<std::pair<std::int64_t, std::int64_t>> months;
+
+    auto day = from / DateTime::SecondsPerDay;
+    auto lastDay = to / DateTime::SecondsPerDay;
+    while (day <= lastDay)
+    {
+        std::int64_t year;
+        unsigned month, dayOfMonth;
+        DateTime::civilFromDays(day, year, month, dayOfMonth);
+
+        // First day of the next month
+        auto next = month == 12 ? DateTime::daysFromCivil(year + 1, 1, 1)
+                                : DateTime::daysFromCivil(year, month + 1, 1);
+        auto end = std::min(next - 1, lastDay);
+
+        months.emplace_back(day * DateTime::SecondsPerDay, end * DateTime::SecondsPerDay);
+        day = next;
+    }
+    return months;
+}
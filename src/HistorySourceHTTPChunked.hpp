@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "HistorySource.hpp"
+
+class HTTPCache;
+class HTTPConnectionPool;
+
+////////////////////////////////////////////////////////////////////////////////
+// History source for long date ranges, fetched as one request per month
+//
+// Months are requested concurrently, a bounded number at a time, and each
+// response is parsed as soon as it arrives. The results are then merged in
+// date order, so a long backfill takes about as long as its slowest month
+// rather than the sum of them all
+////////////////////////////////////////////////////////////////////////////////
+class HistorySourceHTTPChunked final : public HistorySource
+{
+    public:
+    // Fetch [from, to] (timestamps of whole days) from the path on the host,
+    // which takes start and end dates as query parameters, with at most
+    // maxInFlight requests at once
+    HistorySourceHTTPChunked(const std::string& host, const std::string& path,
+        std::int64_t from, std::int64_t to, unsigned maxInFlight, int port = 80);
+    HistorySourceHTTPChunked(const std::string& host, const std::string& path,
+        std::int64_t from, std::int64_t to, unsigned maxInFlight, int port, HTTPConnectionPool& pool);
+
+    const optional<nlohmann::json> get() const override;
+
+    bool read(HistoryAnalyzer& analyzer) const override;
+
+    std::string identity() const override;
+
+    // Make requests through a response cache, or straight to the host if null
+    void setCache(HTTPCache* cache);
+
+    // Split [from, to] into calendar months, clipped to the range, as the
+    // first and last day of each
+    static std::vector<std::pair<std::int64_t, std::int64_t>> splitMonths(std::int64_t from, std::int64_t to);
+
+    private:
+    const std::string   m_host;
+    const std::string   m_path;
+    const std::int64_t  m_from;
+    const std::int64_t  m_to;
+    const unsigned      m_maxInFlight;
+    const int           m_port;
+    HTTPConnectionPool& m_pool;
+    HTTPCache*          m_cache = nullptr;
+};
@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+
+#include "DateTime.hpp"
+#include "HistoryAnalyzer.hpp"
+#include "HistorySourceStore.hpp"
+#include "HistoryStore.hpp"
+#include "HTTPCache.hpp"
+#include "HTTPConnectionPool.hpp"
+#include "Parallel.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+    // Gaps fetched at once, there are rarely more than one or two
+    constexpr unsigned MaxGapsInFlight = 4;
+
+    // Days a price may still be published after, before a day fetched
+    // without one is remembered as having none
+    constexpr std::int64_t PublishGraceDays = 3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistorySourceStore::HistorySourceStore(const std::string& storePath, const std::string& host,
+    const std::string& path, std::int64_t from, std::int64_t to, int port) :
+HistorySource(),
+m_storePath(storePath),
+m_host(host),
+m_path(path),
+m_from(from),
+m_to(to),
+m_port(port) {}
+
+////////////////////////////////////////////////////////////////////////////////
+const optional<nlohmann::json> HistorySourceStore::get() const
+{
+    HistoryAnalyzer analyzer;
+    if (!read(analyzer))
+    {
+        return {};
+    }
+
+    nlohmann::json json;
+    auto& bpi = json["bpi"];
+    for (std::size_t i = 0; i < analyzer.size(); ++i)
+    {
+        auto p = analyzer.getDataPoint(i);
+        bpi[DateTime::format(p.time)] = p.price;
+    }
+    return optional<nlohmann::json>(std::move(json));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistorySourceStore::read(HistoryAnalyzer& analyzer) const
+{
+    HistoryStore store(m_storePath);
+    if (!store.isOpen())
+    {
+        return false;
+    }
+
+    // Only closed days are worth storing, today's price isn't final yet
+    auto now = static_cast<std::int64_t>(std::time(nullptr));
+    auto lastClosed = now - now % DateTime::SecondsPerDay - DateTime::SecondsPerDay;
+    auto lastSettled = lastClosed - PublishGraceDays * DateTime::SecondsPerDay;
+
+    // Gaps don't depend on each other, so are fetched together, each parsed
+    // into its own analyzer by whichever thread fetched it
+    auto gaps = store.missing(m_from, std::min(m_to, lastClosed));
+    std::vector<HistoryAnalyzer> fetched(gaps.size());
+    std::vector<char> succeeded(gaps.size(), 0);
+
+    Parallel::forEach(MaxGapsInFlight, gaps.size(), [&](std::size_t i)
+    {
+        auto query = m_path + "?start=" + DateTime::format(gaps[i].first)
+            + "&end=" + DateTime::format(gaps[i].second);
+
+        std::shared_ptr<httplib::Response> res;
+        {
+            Profiler::Scope scope("fetch");
+            res = m_cache ? m_cache->get(m_host, m_port, query)
+                          : HTTPConnectionPool::shared().get(m_host, m_port, query);
+        }
+        if (!res || res->status != 200)
+        {
+            std::cout << "HTTP Error fetching " << query << ": "
+                << (res ? std::to_string(res->status) : std::string("no response")) << std::endl;
+            return;
+        }
+
+        // Only a parsed bpi object says which days have no price, an empty
+        // or cut off body says nothing
+        succeeded[i] = fetched[i].parse(res->body.data(), res->body.size());
+    });
+
+    // Store whatever was fetched. Days that had no price aren't asked for
+    // again, once they're too old for one to still be published
+    bool stored = true;
+    for (std::size_t i = 0; i < gaps.size(); ++i)
+    {
+        stored = succeeded[i] && store.merge(fetched[i], gaps[i].first, std::min(gaps[i].second, lastSettled))
+            && stored;
+    }
+    if (!stored)
+    {
+        return false;
+    }
+
+    store.read(analyzer, m_from, m_to);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string HistorySourceStore::identity() const
+{
+    return "store:" + m_storePath + "?start=" + DateTime::format(m_from) + "&end=" + DateTime::format(m_to);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistorySourceStore::setCache(HTTPCache* cache)
+{
+    m_cache = cache;
+}
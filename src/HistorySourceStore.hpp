@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+#include "HistorySource.hpp"
+
+class HTTPCache;
+
+////////////////////////////////////////////////////////////////////////////////
+// History source backed by a local HistoryStore
+//
+// Only the days in the range that the store doesn't know yet are fetched,
+// one request per run of missing days, and merged into the store before the
+// range is read back from it. Repeating a request for a range costs nothing,
+// and moving it on by a day fetches just that day. Days fetched without a
+// price are remembered as empty once they're a few days old, so aren't
+// asked for again either, while recent ones are retried in case they're
+// published late.
+////////////////////////////////////////////////////////////////////////////////
+class HistorySourceStore final : public HistorySource
+{
+    public:
+    // Serve [from, to] from the store at storePath, fetching missing days
+    // from the path on the host, which takes start and end dates as query
+    // parameters
+    HistorySourceStore(const std::string& storePath, const std::string& host, const std::string& path,
+        std::int64_t from, std::int64_t to, int port = 80);
+
+    const optional<nlohmann::json> get() const override;
+
+    bool read(HistoryAnalyzer& analyzer) const override;
+
+    std::string identity() const override;
+
+    // Fetch gaps through a response cache, or straight from the host if null
+    void setCache(HTTPCache* cache);
+
+    private:
+    const std::string   m_storePath;
+    const std::string   m_host;
+    const std::string   m_path;
+    const std::int64_t  m_from;
+    const std::int64_t  m_to;
+    const int           m_port;
+    HTTPCache*          m_cache = nullptr;
+};
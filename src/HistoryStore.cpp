@@ -0,0 +1,256 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "DateTime.hpp"
+#include "HistoryAnalyzer.hpp"
+#include "HistoryStore.hpp"
+
+namespace
+{
+    // Start of every store file, bumped if the record layout changes
+    constexpr char Magic[8] = {'B', 'C', 'S', 'T', 'O', 'R', 'E', '1'};
+
+    struct Record
+    {
+        std::int64_t    time;
+        double          price;
+    };
+    static_assert(sizeof(Record) == 16, "Store records must be packed");
+
+    // Price of a day known to have none
+    constexpr double NoPrice = std::numeric_limits<double>::quiet_NaN();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HistoryStore::HistoryStore(const std::string& path) :
+m_path(path)
+{
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file)
+    {
+        // Nothing stored yet
+        m_open = true;
+        return;
+    }
+
+    char magic[sizeof(Magic)];
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)))
+    {
+        std::cout << "Not a history store: " << m_path << std::endl;
+        return;
+    }
+
+    // A trailing partial record is from an interrupted write, so is ignored
+    std::vector<Record> records;
+    Record record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        records.push_back(record);
+    }
+
+    // Records are appended as gaps are filled, so aren't necessarily in order
+    std::stable_sort(records.begin(), records.end(), [](const Record& a, const Record& b)
+    {
+        return a.time < b.time;
+    });
+
+    m_times.reserve(records.size());
+    m_prices.reserve(records.size());
+    for (auto& r : records)
+    {
+        if (std::isnan(r.price))
+        {
+            if (m_empty.empty() || m_empty.back() != r.time)
+            {
+                m_empty.push_back(r.time);
+            }
+        }
+        else if (m_times.empty() || m_times.back() != r.time)
+        {
+            m_times.push_back(r.time);
+            m_prices.push_back(r.price);
+        }
+    }
+
+    // A price found for a day after it was recorded as empty wins
+    m_empty.erase(std::remove_if(m_empty.begin(), m_empty.end(), [this](std::int64_t day)
+    {
+        return std::binary_search(m_times.begin(), m_times.end(), day);
+    }), m_empty.end());
+    m_open = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryStore::isOpen() const
+{
+    return m_open;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t HistoryStore::size() const
+{
+    return m_times.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<std::pair<std::int64_t, std::int64_t>> HistoryStore::missing(std::int64_t from, std::int64_t to) const
+{
+    std::vector<std::pair<std::int64_t, std::int64_t>> gaps;
+
+    auto first = from - from % DateTime::SecondsPerDay;
+    for (auto day = first; day <= to; day += DateTime::SecondsPerDay)
+    {
+        if (contains(day))
+        {
+            continue;
+        }
+
+        // Extend the last gap if this day follows straight on from it
+        if (!gaps.empty() && gaps.back().second + DateTime::SecondsPerDay == day)
+        {
+            gaps.back().second = day;
+        }
+        else
+        {
+            gaps.emplace_back(day, day);
+        }
+    }
+    return gaps;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryStore::merge(const HistoryAnalyzer& data, std::int64_t from, std::int64_t to)
+{
+    // Appending to a file that isn't a store would bury the records
+    if (!m_open)
+    {
+        return false;
+    }
+
+    std::vector<Record> added;
+    for (std::size_t i = 0; i < data.size(); ++i)
+    {
+        auto p = data.getDataPoint(i);
+        auto day = p.time - p.time % DateTime::SecondsPerDay;
+        if (!contains(day) && (added.empty() || added.back().time != day))
+        {
+            added.push_back({day, p.price});
+        }
+    }
+
+    // Whatever else was fetched has no price
+    std::vector<Record> empty;
+    std::size_t next = 0;
+    for (auto day = from - from % DateTime::SecondsPerDay; day <= to; day += DateTime::SecondsPerDay)
+    {
+        for (; next < added.size() && added[next].time < day; ++next);
+        if (!contains(day) && (next == added.size() || added[next].time != day))
+        {
+            empty.push_back({day, NoPrice});
+        }
+    }
+
+    if (added.empty() && empty.empty())
+    {
+        return true;
+    }
+
+    {
+        bool created = m_times.empty() && !std::ifstream(m_path, std::ios::binary);
+        std::ofstream file(m_path, std::ios::binary | std::ios::app);
+        if (created)
+        {
+            file.write(Magic, sizeof(Magic));
+        }
+        file.write(reinterpret_cast<const char*>(added.data()),
+            static_cast<std::streamsize>(added.size() * sizeof(Record)));
+        file.write(reinterpret_cast<const char*>(empty.data()),
+            static_cast<std::streamsize>(empty.size() * sizeof(Record)));
+
+        if (!file)
+        {
+            std::cout << "Failed to write history store " << m_path << std::endl;
+            return false;
+        }
+    }
+
+    // Merge the new days in, keeping chronological order
+    AlignedVector<std::int64_t> times;
+    AlignedVector<double> prices;
+    times.reserve(m_times.size() + added.size());
+    prices.reserve(m_times.size() + added.size());
+
+    std::size_t i = 0;
+    for (auto& r : added)
+    {
+        for (; i < m_times.size() && m_times[i] < r.time; ++i)
+        {
+            times.push_back(m_times[i]);
+            prices.push_back(m_prices[i]);
+        }
+        times.push_back(r.time);
+        prices.push_back(r.price);
+    }
+    for (; i < m_times.size(); ++i)
+    {
+        times.push_back(m_times[i]);
+        prices.push_back(m_prices[i]);
+    }
+
+    m_times = std::move(times);
+    m_prices = std::move(prices);
+
+    auto known = m_empty.size();
+    for (auto& r : empty)
+    {
+        m_empty.push_back(r.time);
+    }
+    std::inplace_merge(m_empty.begin(), m_empty.begin() + static_cast<std::ptrdiff_t>(known), m_empty.end());
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HistoryStore::read(HistoryAnalyzer& analyzer, std::int64_t from, std::int64_t to) const
+{
+    auto begin = std::lower_bound(m_times.begin(), m_times.end(), from) - m_times.begin();
+    auto end = std::upper_bound(m_times.begin(), m_times.end(), to) - m_times.begin();
+    end = std::max(begin, end);
+
+    analyzer.assign(AlignedVector<std::int64_t>(m_times.begin() + begin, m_times.begin() + end),
+        AlignedVector<double>(m_prices.begin() + begin, m_prices.begin() + end));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryStore::contains(std::int64_t day) const
+{
+    return std::binary_search(m_times.begin(), m_times.end(), day)
+        || std::binary_search(m_empty.begin(), m_empty.end(), day);
+}
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AlignedAllocator.hpp"
+
+class HistoryAnalyzer;
+
+////////////////////////////////////////////////////////////////////////////////
+// Local append-only store of daily closing prices
+//
+// Closed days never change, so once a day is known it never has to be
+// fetched again. The file is a short header followed by fixed size
+// (timestamp, price) records, only ever appended to, so an interrupted write
+// loses at most the record being written.
+//
+// Days that were fetched but came back without a price, like days the API
+// hasn't published, are stored as records with a NaN price. They're known
+// too, so aren't fetched again, but are never read back as prices.
+////////////////////////////////////////////////////////////////////////////////
+class HistoryStore final
+{
+    public:
+    // Open the store at path, loading any days already in it. A missing file
+    // is an empty store, created on the first merge
+    HistoryStore(const std::string& path);
+
+    // Whether the file was missing or loaded successfully
+    bool isOpen() const;
+
+    // Number of days with a price
+    std::size_t size() const;
+
+    // Days in [from, to] that aren't in the store, as runs of consecutive days
+    // (timestamps of the first and last day of each)
+    std::vector<std::pair<std::int64_t, std::int64_t>> missing(std::int64_t from, std::int64_t to) const;
+
+    // Append every data point for a day that isn't already known, and record
+    // the days in [from, to] the data has no price for as empty
+    // Returns false if the store didn't open or couldn't be written
+    bool merge(const HistoryAnalyzer& data, std::int64_t from, std::int64_t to);
+
+    // Fill the analyzer with the known days in [from, to]
+    void read(HistoryAnalyzer& analyzer, std::int64_t from, std::int64_t to) const;
+
+    private:
+    // Whether a day is known, given a timestamp at its start
+    bool contains(std::int64_t day) const;
+
+    const std::string           m_path;
+    bool                        m_open = false;
+
+    // Days with a price in chronological order
+    AlignedVector<std::int64_t> m_times;
+    AlignedVector<double>       m_prices;
+
+    // Days known to have no price, in order
+    std::vector<std::int64_t>   m_empty;
+};
@@ -0,0 +1,172 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.hpp"
+
+#if defined(WIN32)
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if defined(WIN32)
+
+////////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile(const std::string& path)
+{
+    auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        return;
+    }
+
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    // Can't map an empty file, but it's still a valid one
+    if (!m_size)
+    {
+        m_open = true;
+        return;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+    {
+        return;
+    }
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    m_open = m_data != nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file)
+    {
+        CloseHandle(m_file);
+    }
+}
+
+#else
+
+////////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile(const std::string& path)
+{
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(m_fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        return;
+    }
+
+    m_size = static_cast<std::size_t>(info.st_size);
+
+    // Can't map an empty file, but it's still a valid one
+    if (!m_size)
+    {
+        m_open = true;
+        return;
+    }
+
+    auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        m_size = 0;
+        return;
+    }
+
+    // We only ever walk the file front to back, so let the kernel read ahead
+    // aggressively and drop pages behind us
+    madvise(data, m_size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char*>(data);
+    m_open = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+    if (m_data)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+    }
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+bool MappedFile::isOpen() const
+{
+    return m_open;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char* MappedFile::data() const
+{
+    return m_data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t MappedFile::size() const
+{
+    return m_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string_view MappedFile::view() const
+{
+    return std::string_view(m_data, m_size);
+}
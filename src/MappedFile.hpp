@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+////////////////////////////////////////////////////////////////////////////////
+// Read only memory mapping of a whole file
+//
+// The mapping is advised for sequential access, and stays valid for the
+// lifetime of the object, so views into it can be handed out freely
+////////////////////////////////////////////////////////////////////////////////
+class MappedFile final
+{
+    public:
+    MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Whether the file was opened and mapped successfully
+    bool isOpen() const;
+
+    // The mapped bytes
+    const char* data() const;
+    std::size_t size() const;
+    std::string_view view() const;
+
+    private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool        m_open = false;
+
+#if defined(WIN32)
+    void*       m_file = nullptr;
+    void*       m_mapping = nullptr;
+#else
+    int         m_fd = -1;
+#endif
+};
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <functional>
+
+#include "MedianTracker.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+void MedianTracker::assign(const double* data, std::size_t count)
+{
+    m_lower.assign(data, data + count);
+    m_upper.clear();
+
+    if (!count)
+    {
+        return;
+    }
+
+    // Partition around the lower middle value, then heapify each half
+    auto split = (count + 1) / 2;
+    std::nth_element(m_lower.begin(), m_lower.begin() + (split - 1), m_lower.end());
+    m_upper.assign(m_lower.begin() + split, m_lower.end());
+    m_lower.resize(split);
+
+    std::make_heap(m_lower.begin(), m_lower.end());
+    std::make_heap(m_upper.begin(), m_upper.end(), std::greater<double>());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MedianTracker::add(double value)
+{
+    if (m_lower.empty() || value <= m_lower.front())
+    {
+        m_lower.push_back(value);
+        std::push_heap(m_lower.begin(), m_lower.end());
+    }
+    else
+    {
+        m_upper.push_back(value);
+        std::push_heap(m_upper.begin(), m_upper.end(), std::greater<double>());
+    }
+
+    // Rebalance so the lower half has the same number or one more
+    if (m_lower.size() > m_upper.size() + 1)
+    {
+        std::pop_heap(m_lower.begin(), m_lower.end());
+        m_upper.push_back(m_lower.back());
+        m_lower.pop_back();
+        std::push_heap(m_upper.begin(), m_upper.end(), std::greater<double>());
+    }
+    else if (m_upper.size() > m_lower.size())
+    {
+        std::pop_heap(m_upper.begin(), m_upper.end(), std::greater<double>());
+        m_lower.push_back(m_upper.back());
+        m_upper.pop_back();
+        std::push_heap(m_lower.begin(), m_lower.end());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t MedianTracker::count() const
+{
+    return m_lower.size() + m_upper.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double MedianTracker::median() const
+{
+    if (m_lower.size() > m_upper.size())
+    {
+        return m_lower.front();
+    }
+    return (m_lower.front() + m_upper.front()) / 2;
+}
@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Running median of a growing set of values
+//
+// Keeps the lower half of the values in a max heap and the upper half in a
+// min heap, so adding a value is O(log n) and reading the median is O(1)
+////////////////////////////////////////////////////////////////////////////////
+class MedianTracker final
+{
+    public:
+
+    // Replace the tracked values, in linear time
+    void assign(const double* data, std::size_t count);
+
+    // Add a value
+    void add(double value);
+
+    // Number of values tracked
+    std::size_t count() const;
+
+    // The median, averaging the middle two values for an even count
+    // There must be at least one value
+    double median() const;
+
+    private:
+    std::vector<double> m_lower;    // Max heap, holds the extra value for odd counts
+    std::vector<double> m_upper;    // Min heap
+};
@@ -0,0 +1,267 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "MockHistoryServer.hpp"
+
+const std::string MockHistoryServer::Path = "/v1/bpi/historical/close.json";
+
+namespace
+{
+    // Mix the bits of a value, so neighbouring times get unrelated noise
+    std::uint64_t splitMix(std::uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    // Frame a body in chunks of the given size for chunked transfer encoding
+    std::string encodeChunked(const std::string& body, std::size_t chunkSize)
+    {
+        std::string encoded;
+        encoded.reserve(body.size() + (body.size() / chunkSize + 1) * 16);
+
+        char size[32];
+        for (std::size_t offset = 0; offset < body.size(); offset += chunkSize)
+        {
+            auto length = std::min(chunkSize, body.size() - offset);
+            encoded.append(size, std::snprintf(size, sizeof(size), "%zx\r\n", length));
+            encoded.append(body, offset, length);
+            encoded += "\r\n";
+        }
+        encoded += "0\r\n\r\n";
+        return encoded;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MockHistoryServer::MockHistoryServer() :
+MockHistoryServer(Options()) {}
+
+////////////////////////////////////////////////////////////////////////////////
+MockHistoryServer::MockHistoryServer(const Options& options) :
+m_options(options),
+m_default(generate(m_options.start, m_options.points))
+{
+    m_server.set_thread_pool(m_options.threads, m_options.threads * 4);
+
+    // Keep connections open, so benchmarks measure requests, not handshakes
+    m_server.set_keep_alive_max_count(1000);
+    m_server.Get(Path.c_str(), [this](const httplib::Request& request, httplib::Response& response)
+    {
+        auto active = ++m_active;
+        auto peak = m_peak.load();
+        while (active > peak && !m_peak.compare_exchange_weak(peak, active)) {}
+
+        handle(request, response);
+        --m_active;
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MockHistoryServer::~MockHistoryServer()
+{
+    stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int MockHistoryServer::start()
+{
+    if (m_thread.joinable())
+    {
+        return m_port;
+    }
+
+    m_port = m_server.bind_to_any_port("127.0.0.1");
+    if (m_port < 0)
+    {
+        std::cout << "Mock history server failed to bind" << std::endl;
+        return -1;
+    }
+
+    m_thread = std::thread([this] { m_server.listen_after_bind(); });
+
+    // Stopping has no effect until the server is running
+    while (!m_server.is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return m_port;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MockHistoryServer::stop()
+{
+    if (m_thread.joinable())
+    {
+        m_server.stop();
+        m_thread.join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int MockHistoryServer::port() const
+{
+    return m_port;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const MockHistoryServer::Options& MockHistoryServer::options() const
+{
+    return m_options;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string MockHistoryServer::query(std::int64_t start, std::int64_t end)
+{
+    return Path + "?start=" + DateTime::format(start) + "&end=" + DateTime::format(end);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double MockHistoryServer::price(std::int64_t time, std::uint64_t seed)
+{
+    // A monthly swing with some noise, to four places as the API gives them
+    const double month = 30. * DateTime::SecondsPerDay;
+    auto noise = static_cast<double>(splitMix(seed ^ static_cast<std::uint64_t>(time)) >> 11) / 9007199254740992.;
+    auto price = 10000. + 2000. * std::sin(6.283185307179586 * time / month) + 500. * noise;
+    return std::round(price * 10000.) / 10000.;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const std::string& MockHistoryServer::history() const
+{
+    return m_default;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string MockHistoryServer::history(std::int64_t start, std::int64_t end) const
+{
+    if (start > end)
+    {
+        return generate(start, 0);
+    }
+    return generate(start, static_cast<std::size_t>((end - start) / m_options.interval + 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string MockHistoryServer::generate(std::int64_t start, std::size_t count) const
+{
+    std::string text;
+    text.reserve(count * 32 + 128);
+    text += "{\"bpi\":{";
+
+    char line[64];
+    char date[DateTime::MaxLength + 1] = {};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto time = start + static_cast<std::int64_t>(i) * m_options.interval;
+        date[DateTime::format(time, date)] = '\0';
+        text.append(line, std::snprintf(line, sizeof(line), "%s\"%s\":%.4f", i ? "," : "", date,
+            price(time, m_options.seed)));
+    }
+
+    text += "},\"disclaimer\":\"Synthetic data served by MockHistoryServer\"}";
+    return text;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t MockHistoryServer::requests() const
+{
+    return m_requests;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t MockHistoryServer::failures() const
+{
+    return m_failures;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t MockHistoryServer::peakConcurrency() const
+{
+    return m_peak;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void MockHistoryServer::handle(const httplib::Request& request, httplib::Response& response)
+{
+    auto number = ++m_requests;
+
+    if (m_options.latency.count() > 0)
+    {
+        std::this_thread::sleep_for(m_options.latency);
+    }
+
+    auto failing = m_options.failEvery && number % m_options.failEvery == 0;
+    if (failing && m_options.failure == Failure::Status)
+    {
+        ++m_failures;
+        response.status = m_options.failStatus;
+        response.set_content("Injected failure", "text/plain");
+        return;
+    }
+
+    std::string body;
+    if (request.has_param("start") || request.has_param("end"))
+    {
+        std::int64_t start, end;
+        if (!DateTime::parse(request.get_param_value("start"), start)
+            || !DateTime::parse(request.get_param_value("end"), end)
+            || start > end)
+        {
+            response.status = 404;
+            response.set_content("Sorry, the start and end dates are invalid", "text/plain");
+            return;
+        }
+        body = history(start, end);
+    }
+    else
+    {
+        body = m_default;
+    }
+
+    if (failing)
+    {
+        ++m_failures;
+        body.resize(body.size() / 2);
+    }
+
+    if (m_options.chunkSize)
+    {
+        response.body = encodeChunked(body, m_options.chunkSize);
+        response.set_header("Transfer-Encoding", "chunked");
+        response.set_header("Content-Type", "application/json");
+    }
+    else
+    {
+        response.body = std::move(body);
+        response.set_header("Content-Type", "application/json");
+    }
+}
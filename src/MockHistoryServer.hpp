@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include <http/httplib.hpp>
+
+#include "DateTime.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// An in-process stand in for the coindesk history API, for testing and
+// benchmarking the HTTP sources without a network
+//
+// Serves synthetic bpi json at Path on the loopback interface. Prices are a
+// function of the timestamp and seed alone, so any range asked for agrees
+// with every other. Requests with ?start=&end= get every interval from start
+// to end inclusive, and requests without get the configured number of points
+//
+// Responses can be delayed, sent with chunked transfer encoding, and made to
+// fail every so many requests, all deterministically
+////////////////////////////////////////////////////////////////////////////////
+class MockHistoryServer final
+{
+    public:
+    // How failing requests fail
+    enum class Failure
+    {
+        Status,     // Respond with failStatus and no history
+        Truncated   // Respond 200 with the json cut off half way
+    };
+
+    struct Options
+    {
+        // History served when no range is asked for
+        std::size_t                 points = 31;
+        std::int64_t                start = 1514764800; // 2018-01-01
+        std::int64_t                interval = DateTime::SecondsPerDay;
+        std::uint64_t               seed = 42;
+
+        // Delay before each response
+        std::chrono::milliseconds   latency{0};
+
+        // Send bodies in chunks of this many bytes, 0 to send them whole
+        std::size_t                 chunkSize = 0;
+
+        // Fail every nth request, 0 to never fail
+        std::size_t                 failEvery = 0;
+        Failure                     failure = Failure::Status;
+        int                         failStatus = 503;
+
+        // Threads handling connections, which bounds concurrent requests
+        std::size_t                 threads = 8;
+    };
+
+    static const std::string Path;
+
+    MockHistoryServer();
+    explicit MockHistoryServer(const Options& options);
+    ~MockHistoryServer();
+
+    MockHistoryServer(const MockHistoryServer&) = delete;
+    MockHistoryServer& operator=(const MockHistoryServer&) = delete;
+
+    // Start serving on a free port of 127.0.0.1, returning once connections
+    // are being accepted
+    // Returns the port, or -1 if failure
+    int start();
+
+    // Stop serving, waiting for the server thread to finish
+    void stop();
+
+    int port() const;
+
+    const Options& options() const;
+
+    // The query for a date range, as the coindesk API takes it
+    static std::string query(std::int64_t start, std::int64_t end);
+
+    // The price served for a time
+    static double price(std::int64_t time, std::uint64_t seed);
+
+    // The json served for the configured points, and for a range
+    const std::string& history() const;
+    std::string history(std::int64_t start, std::int64_t end) const;
+
+    // Number of requests received, and how many of them were failed
+    std::size_t requests() const;
+    std::size_t failures() const;
+
+    // Most requests handled at the same time
+    std::size_t peakConcurrency() const;
+
+    private:
+    // The json for count points from start
+    std::string generate(std::int64_t start, std::size_t count) const;
+
+    void handle(const httplib::Request& request, httplib::Response& response);
+
+    const Options               m_options;
+    httplib::Server             m_server;
+    std::thread                 m_thread;
+    int                         m_port = -1;
+
+    // The history for requests without a range, built up front
+    const std::string           m_default;
+
+    std::atomic<std::size_t>    m_requests{0};
+    std::atomic<std::size_t>    m_failures{0};
+    std::atomic<std::size_t>    m_active{0};
+    std::atomic<std::size_t>    m_peak{0};
+};
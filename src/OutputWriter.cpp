@@ -0,0 +1,463 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "DateTime.hpp"
+#include "OutputWriter.hpp"
+
+namespace
+{
+    // Large enough that writes to the stream are few and far between
+    constexpr std::size_t BufferSize = 1 << 16;
+
+    // Longest shortest round trip double, "-2.2250738585072014e-308"
+    constexpr std::size_t MaxNumberLength = 32;
+
+    // Write a double with six significant digits, as iostreams do by
+    // default, or with enough to read back the same double
+    // Returns the length written
+    std::size_t formatNumber(char* text, double value, bool exact)
+    {
+#if defined(BCSTATS_HAS_FLOAT_TO_CHARS)
+        auto result = exact ? std::to_chars(text, text + MaxNumberLength, value)
+                            : std::to_chars(text, text + MaxNumberLength, value, std::chars_format::general, 6);
+        return static_cast<std::size_t>(result.ptr - text);
+#else
+        // Without floating point to_chars, 17 digits always round trip,
+        // if not always in the fewest digits
+        return static_cast<std::size_t>(std::snprintf(text, MaxNumberLength, exact ? "%.17g" : "%g", value));
+#endif
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+OutputWriter::OutputWriter(std::ostream& out, Format format) :
+m_out(out),
+m_format(format),
+m_buffer(BufferSize) {}
+
+////////////////////////////////////////////////////////////////////////////////
+OutputWriter::~OutputWriter()
+{
+    finish();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool OutputWriter::parseFormat(const std::string& name, Format& format)
+{
+    static const std::pair<const char*, Format> names[] =
+    {
+        {"text", Format::Text},
+        {"json", Format::JSON},
+        {"csv", Format::CSV},
+        {"ndjson", Format::NDJSON}
+    };
+
+    for (auto& entry : names)
+    {
+        if (name == entry.first)
+        {
+            format = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+OutputWriter::Format OutputWriter::format() const
+{
+    return m_format;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::point(const HistoryAnalyzer::DataPoint& point)
+{
+    auto first = begin(Section::Points);
+
+    switch (m_format)
+    {
+        case Format::Text:
+            writeTime(point.time);
+            write(": ");
+            writeNumber(point.price);
+            write('\n');
+            break;
+
+        case Format::CSV:
+            if (first)
+            {
+                write("time,price\n");
+            }
+            writeTime(point.time);
+            write(',');
+            writeNumber(point.price);
+            write('\n');
+            break;
+
+        case Format::JSON:
+        case Format::NDJSON:
+            if (m_format == Format::JSON && !first)
+            {
+                write(',');
+            }
+            write("{\"time\":\"");
+            writeTime(point.time);
+            write("\",\"price\":");
+            writeNumber(point.price);
+            write(m_format == Format::JSON ? "}" : "}\n");
+            break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::stats(const HistoryAnalyzer::Stats& stats)
+{
+    begin(Section::Stats);
+
+    switch (m_format)
+    {
+        case Format::Text:
+            write("Stats for data:\nTotal samples: ");
+            writeNumber(static_cast<std::uint64_t>(stats.dataSize));
+            write("\nHighest price was $");
+            writeNumber(stats.highest.price);
+            write(" on ");
+            writeTime(stats.highest.time);
+            write("\nLowest price was $");
+            writeNumber(stats.lowest.price);
+            write(" on ");
+            writeTime(stats.lowest.time);
+            write("\nMean price was $");
+            writeNumber(stats.meanPrice);
+            write("\nMedian price was $");
+            writeNumber(stats.medianPrice);
+            write("\nStandard deviation of $");
+            writeNumber(stats.standardDeviation);
+            write('\n');
+            break;
+
+        case Format::CSV:
+            write("samples,highest,highestTime,lowest,lowestTime,mean,median,standardDeviation\n");
+            writeCsvStats(stats);
+            write('\n');
+            break;
+
+        case Format::JSON:
+        case Format::NDJSON:
+            write('{');
+            writeJsonStats(stats);
+            write(m_format == Format::JSON ? "}" : "}\n");
+            break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::file(const std::string& path, const HistoryAnalyzer::Stats* stats)
+{
+    auto first = begin(Section::Files);
+
+    switch (m_format)
+    {
+        case Format::Text:
+            write(path);
+            if (!stats)
+            {
+                write(": failed\n");
+                break;
+            }
+            write(": ");
+            writeNumber(static_cast<std::uint64_t>(stats->dataSize));
+            write(" samples, highest $");
+            writeNumber(stats->highest.price);
+            write(" on ");
+            writeTime(stats->highest.time);
+            write(", lowest $");
+            writeNumber(stats->lowest.price);
+            write(" on ");
+            writeTime(stats->lowest.time);
+            write(", mean $");
+            writeNumber(stats->meanPrice);
+            write(", median $");
+            writeNumber(stats->medianPrice);
+            write(", standard deviation $");
+            writeNumber(stats->standardDeviation);
+            write('\n');
+            break;
+
+        case Format::CSV:
+            if (first)
+            {
+                write("path,samples,highest,highestTime,lowest,lowestTime,mean,median,standardDeviation\n");
+            }
+            writeString(path);
+            write(',');
+            if (stats)
+            {
+                writeCsvStats(*stats);
+            }
+            else
+            {
+                write(",,,,,,,");
+            }
+            write('\n');
+            break;
+
+        case Format::JSON:
+        case Format::NDJSON:
+            if (m_format == Format::JSON && !first)
+            {
+                write(',');
+            }
+            write("{\"path\":");
+            writeString(path);
+            if (stats)
+            {
+                write(',');
+                writeJsonStats(*stats);
+            }
+            else
+            {
+                write(",\"error\":\"failed\"");
+            }
+            write(m_format == Format::JSON ? "}" : "}\n");
+            break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::finish()
+{
+    if (m_finished)
+    {
+        return;
+    }
+    m_finished = true;
+
+    end();
+    if (m_format == Format::JSON)
+    {
+        write(m_started ? "}\n" : "{}\n");
+    }
+    flush();
+    m_out.flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool OutputWriter::begin(Section section)
+{
+    if (m_section == section)
+    {
+        return false;
+    }
+    end();
+
+    if (m_format == Format::JSON)
+    {
+        write(m_started ? "," : "{");
+        switch (section)
+        {
+            case Section::Points:   write("\"points\":["); break;
+            case Section::Stats:    write("\"stats\":"); break;
+            case Section::Files:    write("\"files\":["); break;
+            case Section::None:     break;
+        }
+    }
+    else if (m_format == Format::CSV && m_started)
+    {
+        write('\n');
+    }
+
+    m_section = section;
+    m_started = true;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::end()
+{
+    if (m_format == Format::JSON && (m_section == Section::Points || m_section == Section::Files))
+    {
+        write(']');
+    }
+    m_section = Section::None;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::write(std::string_view text)
+{
+    if (text.size() > m_buffer.size() - m_used)
+    {
+        flush();
+        if (text.size() > m_buffer.size())
+        {
+            m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+            return;
+        }
+    }
+    std::memcpy(m_buffer.data() + m_used, text.data(), text.size());
+    m_used += text.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::write(char c)
+{
+    if (m_used == m_buffer.size())
+    {
+        flush();
+    }
+    m_buffer[m_used++] = c;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::writeNumber(double value)
+{
+    if (m_format != Format::Text && !std::isfinite(value))
+    {
+        // Neither JSON nor a spreadsheet will read nan or inf back
+        if (m_format != Format::CSV)
+        {
+            write("null");
+        }
+        return;
+    }
+
+    char text[MaxNumberLength];
+    write(std::string_view(text, formatNumber(text, value, m_format != Format::Text)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::writeNumber(std::uint64_t value)
+{
+    char text[MaxNumberLength];
+    write(std::string_view(text, static_cast<std::size_t>(std::to_chars(text, text + sizeof(text), value).ptr - text)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::writeTime(std::int64_t time)
+{
+    char text[DateTime::MaxLength];
+    write(std::string_view(text, DateTime::format(time, text)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::writeString(std::string_view text)
+{
+    if (m_format == Format::CSV)
+    {
+        // Quoted only if it has to be, with quotes doubled
+        if (text.find_first_of(",\"\r\n") == std::string_view::npos)
+        {
+            write(text);
+            return;
+        }
+        write('"');
+        for (auto c : text)
+        {
+            if (c == '"')
+            {
+                write('"');
+            }
+            write(c);
+        }
+        write('"');
+        return;
+    }
+
+    write('"');
+    for (auto c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            write('\\');
+            write(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            write(std::string_view(escaped, static_cast<std::size_t>(
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c)))));
+        }
+        else
+        {
+            write(c);
+        }
+    }
+    write('"');
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::writeJsonStats(const HistoryAnalyzer::Stats& stats)
+{
+    write("\"samples\":");
+    writeNumber(static_cast<std::uint64_t>(stats.dataSize));
+    write(",\"highest\":{\"time\":\"");
+    writeTime(stats.highest.time);
+    write("\",\"price\":");
+    writeNumber(stats.highest.price);
+    write("},\"lowest\":{\"time\":\"");
+    writeTime(stats.lowest.time);
+    write("\",\"price\":");
+    writeNumber(stats.lowest.price);
+    write("},\"mean\":");
+    writeNumber(stats.meanPrice);
+    write(",\"median\":");
+    writeNumber(stats.medianPrice);
+    write(",\"standardDeviation\":");
+    writeNumber(stats.standardDeviation);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::writeCsvStats(const HistoryAnalyzer::Stats& stats)
+{
+    writeNumber(static_cast<std::uint64_t>(stats.dataSize));
+    write(',');
+    writeNumber(stats.highest.price);
+    write(',');
+    writeTime(stats.highest.time);
+    write(',');
+    writeNumber(stats.lowest.price);
+    write(',');
+    writeTime(stats.lowest.time);
+    write(',');
+    writeNumber(stats.meanPrice);
+    write(',');
+    writeNumber(stats.medianPrice);
+    write(',');
+    writeNumber(stats.standardDeviation);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void OutputWriter::flush()
+{
+    if (m_used)
+    {
+        m_out.write(m_buffer.data(), static_cast<std::streamsize>(m_used));
+        m_used = 0;
+    }
+}
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HistoryAnalyzer.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes data points and stats as text for people, or as JSON, CSV or
+// newline delimited JSON for other tools
+//
+// Everything goes through one buffer that's only written out when full, so
+// dumping a long series costs about as much as the disk does. Machine
+// formats write prices with the shortest digits that read back to the same
+// double, using std::to_chars where the standard library has it for
+// floating point, and 17 significant digits otherwise
+//
+// Records of a kind are written together: points, the stats for a single
+// source, or the stats for each file of a batch. In JSON they become the
+// "points" array, "stats" object and "files" array of one document, and in
+// CSV a table each, with a header, separated by a blank line
+////////////////////////////////////////////////////////////////////////////////
+class OutputWriter final
+{
+    public:
+    enum class Format
+    {
+        Text,
+        JSON,
+        CSV,
+        NDJSON
+    };
+
+    OutputWriter(std::ostream& out, Format format);
+
+    // Finishes the output
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Parse a format name (text, json, csv, ndjson)
+    // Returns false if the name isn't known
+    static bool parseFormat(const std::string& name, Format& format);
+
+    Format format() const;
+
+    // A raw data point
+    void point(const HistoryAnalyzer::DataPoint& point);
+
+    // Stats for the one source analyzed
+    void stats(const HistoryAnalyzer::Stats& stats);
+
+    // Stats for a file of a batch, or its failure if stats is null
+    void file(const std::string& path, const HistoryAnalyzer::Stats* stats);
+
+    // Close any open document and write everything buffered
+    void finish();
+
+    private:
+    enum class Section
+    {
+        None,
+        Points,
+        Stats,
+        Files
+    };
+
+    // Start a run of records of a kind, ending the previous run
+    // Returns true if this is the first record of the run
+    bool begin(Section section);
+    void end();
+
+    void write(std::string_view text);
+    void write(char c);
+    void writeNumber(double value);
+    void writeNumber(std::uint64_t value);
+    void writeTime(std::int64_t time);
+    void writeString(std::string_view text);
+
+    // Stats fields for JSON, without the surrounding braces
+    void writeJsonStats(const HistoryAnalyzer::Stats& stats);
+    void writeCsvStats(const HistoryAnalyzer::Stats& stats);
+
+    void flush();
+
+    std::ostream&       m_out;
+    const Format        m_format;
+    std::vector<char>   m_buffer;
+    std::size_t         m_used = 0;
+    Section             m_section = Section::None;
+    bool                m_started = false;
+    bool                m_finished = false;
+};
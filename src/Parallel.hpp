@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers for splitting work over threads
+////////////////////////////////////////////////////////////////////////////////
+class Parallel final
+{
+    public:
+
+    // Resolve a requested thread count, 0 meaning one per core
+    static unsigned threadCount(unsigned requested)
+    {
+        if (requested)
+        {
+            return requested;
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Split [0, count) into contiguous chunks, at most one per thread and none
+    // smaller than minChunk, then run function(begin, end, chunk) on each
+    // concurrently. The calling thread takes the first chunk
+    // Returns the number of chunks used
+    template<class Function>
+    static std::size_t forChunks(unsigned threads, std::size_t count, std::size_t minChunk, Function&& function)
+    {
+        auto chunks = std::max<std::size_t>(1,
+            std::min<std::size_t>(threads, count / std::max<std::size_t>(minChunk, 1)));
+
+        if (chunks == 1)
+        {
+            function(std::size_t(0), count, std::size_t(0));
+            return 1;
+        }
+
+        auto chunkSize = count / chunks;
+        auto remainder = count % chunks;
+
+        std::vector<std::thread> workers;
+        workers.reserve(chunks - 1);
+
+        std::size_t begin = chunkSize + (remainder > 0);
+        auto firstEnd = begin;
+        for (std::size_t chunk = 1; chunk < chunks; ++chunk)
+        {
+            auto end = begin + chunkSize + (chunk < remainder);
+            workers.emplace_back([&function, begin, end, chunk]
+            {
+                function(begin, end, chunk);
+            });
+            begin = end;
+        }
+
+        function(std::size_t(0), firstEnd, std::size_t(0));
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        return chunks;
+    }
+
+    // Run function(index) for every index in [0, count), with at most threads
+    // running at once. Indices are handed out in order as threads become free,
+    // so uneven work, like waiting on network requests, stays balanced. The
+    // calling thread is one of the workers
+    template<class Function>
+    static void forEach(unsigned threads, std::size_t count, Function&& function)
+    {
+        auto workerCount = std::min<std::size_t>(std::max(1u, threads), count);
+        std::atomic<std::size_t> next(0);
+
+        auto work = [&function, &next, count]
+        {
+            for (auto index = next++; index < count; index = next++)
+            {
+                function(index);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (std::size_t worker = 1; worker < workerCount; ++worker)
+        {
+            workers.emplace_back(work);
+        }
+
+        work();
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+};
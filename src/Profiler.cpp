@@ -0,0 +1,325 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "Profiler.hpp"
+
+#if defined(WIN32)
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+namespace
+{
+    std::atomic<bool>           enabled{false};
+    std::atomic<bool>           counting{false};
+    std::atomic<std::uint64_t>  allocatedBytes{0};
+    std::atomic<std::uint64_t>  allocationCount{0};
+
+    // Nesting of scopes on this thread
+    thread_local unsigned       depth = 0;
+
+    std::mutex                  phasesMutex;
+    std::vector<Profiler::Phase> recorded;
+
+    // The thread that enabled profiling, scopes on any other being workers
+    std::thread::id             profilingThread;
+
+    std::string formatBytes(std::uint64_t bytes)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+        if (bytes >= 1024 * 1024)
+        {
+            out << bytes / (1024. * 1024.) << "MB";
+        }
+        else if (bytes >= 1024)
+        {
+            out << bytes / 1024. << "KB";
+        }
+        else
+        {
+            out << bytes << "B";
+        }
+        return out.str();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Profiler::Scope::Scope(const char* name)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    // Phases are listed in the order they start, so parents come before the
+    // phases nested in them
+    {
+        std::lock_guard<std::mutex> lock(phasesMutex);
+        auto worker = std::this_thread::get_id() != profilingThread;
+        auto phase = std::find_if(recorded.begin(), recorded.end(), [name, worker](const Phase& phase)
+        {
+            return phase.name == name && phase.worker == worker;
+        });
+        if (phase == recorded.end())
+        {
+            recorded.push_back({name, depth, 0, 0., 0., 0, 0, 0, worker});
+            phase = recorded.end() - 1;
+        }
+        m_index = static_cast<std::size_t>(phase - recorded.begin());
+    }
+
+    m_active = true;
+    ++depth;
+    m_bytesStart = bytesAllocated();
+    m_allocationsStart = allocations();
+    m_cpuStart = cpuSeconds();
+    m_start = std::chrono::steady_clock::now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Profiler::Scope::~Scope()
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - m_start;
+    auto cpu = cpuSeconds() - m_cpuStart;
+    auto bytes = bytesAllocated() - m_bytesStart;
+    auto count = allocations() - m_allocationsStart;
+    auto peak = peakResidentBytes();
+    --depth;
+
+    std::lock_guard<std::mutex> lock(phasesMutex);
+    if (m_index >= recorded.size())
+    {
+        return;
+    }
+
+    auto& phase = recorded[m_index];
+    ++phase.calls;
+    phase.wallSeconds += wall.count();
+    phase.cpuSeconds += cpu;
+    phase.bytesAllocated += bytes;
+    phase.allocations += count;
+    phase.peakResidentBytes = std::max(phase.peakResidentBytes, peak);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Profiler::setEnabled(bool enable)
+{
+    if (enable)
+    {
+        std::lock_guard<std::mutex> lock(phasesMutex);
+        profilingThread = std::this_thread::get_id();
+    }
+    enabled = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Profiler::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<Profiler::Phase> Profiler::phases()
+{
+    std::lock_guard<std::mutex> lock(phasesMutex);
+    return recorded;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Profiler::reset()
+{
+    std::lock_guard<std::mutex> lock(phasesMutex);
+    recorded.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Profiler::report(std::ostream& out)
+{
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    out << std::left << std::setw(24) << "Phase" << std::right
+        << std::setw(8) << "Calls"
+        << std::setw(12) << "Wall"
+        << std::setw(12) << "CPU"
+        << std::setw(12) << "Allocated"
+        << std::setw(10) << "Allocs"
+        << std::setw(12) << "Peak RSS" << std::endl;
+
+    out << std::fixed << std::setprecision(3);
+
+    auto counted = countsAllocations();
+    auto row = [&out, counted](const Phase& phase)
+    {
+        out << std::left << std::setw(24) << (std::string(phase.depth * 2, ' ') + phase.name) << std::right
+            << std::setw(8) << phase.calls
+            << std::setw(11) << phase.wallSeconds * 1000. << "ms"
+            << std::setw(10) << phase.cpuSeconds * 1000. << "ms"
+            << std::setw(12) << (counted ? formatBytes(phase.bytesAllocated) : "-")
+            << std::setw(10) << (counted ? std::to_string(phase.allocations) : "-")
+            << std::setw(12) << formatBytes(phase.peakResidentBytes) << std::endl;
+    };
+
+    auto all = phases();
+    for (auto& phase : all)
+    {
+        if (!phase.worker)
+        {
+            row(phase);
+        }
+    }
+
+    if (std::any_of(all.begin(), all.end(), [](const Phase& phase) { return phase.worker; }))
+    {
+        out << "On worker threads, summed over threads:" << std::endl;
+        for (auto& phase : all)
+        {
+            if (phase.worker)
+            {
+                row(phase);
+            }
+        }
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Profiler::countAllocation(std::size_t size)
+{
+    if (enabled.load(std::memory_order_relaxed))
+    {
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Profiler::countsAllocations()
+{
+    return counting.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Profiler::setCountsAllocations(bool counts)
+{
+    counting = counts;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint64_t Profiler::bytesAllocated()
+{
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint64_t Profiler::allocations()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+#if defined(WIN32)
+
+////////////////////////////////////////////////////////////////////////////////
+double Profiler::cpuSeconds()
+{
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    {
+        return 0.;
+    }
+
+    // In units of 100ns
+    auto ticks = [](const FILETIME& time)
+    {
+        return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 1e7;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t Profiler::peakResidentBytes()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+#else
+
+////////////////////////////////////////////////////////////////////////////////
+double Profiler::cpuSeconds()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+    {
+        return 0.;
+    }
+
+    auto seconds = [](const timeval& time)
+    {
+        return time.tv_sec + time.tv_usec / 1e6;
+    };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t Profiler::peakResidentBytes()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+    {
+        return 0;
+    }
+
+    // Kilobytes on Linux, bytes on macOS
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+#endif
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Per phase timing and allocation counts
+//
+// Code marks a phase by putting a Scope on the stack. Scopes with the same
+// name are added together, and each one records:
+//
+// - Wall time
+// - CPU time of the whole process, so work on other threads counts
+// - Bytes and number of allocations made by the process
+// - Peak resident memory of the process by the end of the phase
+//
+// Phases nest, and everything is inclusive of nested phases. While disabled,
+// a Scope checks a flag and does nothing else, as does counting allocations
+//
+// Scopes on threads other than the one that enabled profiling, like the
+// workers of Parallel::forEach, are kept apart as worker phases. They nest
+// only within their own thread, and their times add up over every thread
+// that ran them, so they can exceed the wall time of the enclosing phase
+//
+// Allocations are only counted in programs that link ProfilerAllocator.cpp,
+// which replaces the global allocation functions. The library doesn't, so
+// linking it never changes how a program allocates
+////////////////////////////////////////////////////////////////////////////////
+class Profiler final
+{
+    public:
+    struct Phase
+    {
+        std::string     name;
+        unsigned        depth;          // How many phases it's nested in
+        std::size_t     calls;
+        double          wallSeconds;
+        double          cpuSeconds;
+        std::uint64_t   bytesAllocated;
+        std::uint64_t   allocations;
+        std::size_t     peakResidentBytes;
+        bool            worker;         // Ran on threads other than the profiling one
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Records a phase from construction to destruction
+    ////////////////////////////////////////////////////////////////////////////
+    class Scope final
+    {
+        public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        private:
+        bool                                    m_active = false;
+        std::size_t                             m_index = 0;
+        std::chrono::steady_clock::time_point   m_start;
+        double                                  m_cpuStart = 0.;
+        std::uint64_t                           m_bytesStart = 0;
+        std::uint64_t                           m_allocationsStart = 0;
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Phases recorded so far, in the order they first started
+    static std::vector<Phase> phases();
+
+    // Forget every phase recorded, while no scopes are open
+    static void reset();
+
+    // Print a table of the phases
+    static void report(std::ostream& out);
+
+    // Count an allocation, while enabled. Called by the replacement
+    // allocation functions in ProfilerAllocator.cpp
+    static void countAllocation(std::size_t size);
+
+    // Whether allocations are being counted at all, which is only once
+    // ProfilerAllocator.cpp is linked in
+    static bool countsAllocations();
+    static void setCountsAllocations(bool counts);
+
+    // Process wide counters, allocations only being counted while enabled
+    static std::uint64_t bytesAllocated();
+    static std::uint64_t allocations();
+    static double cpuSeconds();
+    static std::size_t peakResidentBytes();
+};
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Replacements for the global allocation functions, so the Profiler can
+// count allocations everywhere, including inside the standard library
+//
+// Only bcstats links this, as replacing the allocator is a decision for the
+// program rather than the library. Array forms and the nothrow forms fall
+// through to these
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include "Profiler.hpp"
+
+#if defined(WIN32)
+    #include <malloc.h>
+#endif
+
+namespace
+{
+    // Let the profiler know allocations are being counted
+    const bool registered = (Profiler::setCountsAllocations(true), true);
+
+    void* allocate(std::size_t size)
+    {
+        Profiler::countAllocation(size);
+        if (auto pointer = std::malloc(size ? size : 1))
+        {
+            return pointer;
+        }
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        Profiler::countAllocation(size);
+        auto align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+#if defined(WIN32)
+        if (auto pointer = _aligned_malloc(size ? size : 1, align))
+        {
+            return pointer;
+        }
+#else
+        void* pointer = nullptr;
+        if (posix_memalign(&pointer, align, size ? size : 1) == 0)
+        {
+            return pointer;
+        }
+#endif
+        throw std::bad_alloc();
+    }
+
+    void freeAligned(void* pointer)
+    {
+#if defined(WIN32)
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateAligned(size, alignment);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    freeAligned(pointer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    freeAligned(pointer);
+}
@@ -0,0 +1,306 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Reduction.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define BCSTATS_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+// MSVC lets any function use any intrinsic, gcc and clang need telling
+#if defined(BCSTATS_X86) && !defined(_MSC_VER)
+    #define BCSTATS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define BCSTATS_TARGET_AVX2
+#endif
+
+namespace
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // Fold a range of values into an existing result, one at a time
+    ////////////////////////////////////////////////////////////////////////////
+    void reduceScalar(const double* data, std::size_t begin, std::size_t end, double shift,
+        Reduction::Result& result)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto x = data[i];
+            if (x < result.min)
+            {
+                result.min = x;
+                result.argMin = i;
+            }
+            if (x > result.max)
+            {
+                result.max = x;
+                result.argMax = i;
+            }
+            auto d = x - shift;
+            result.sum += d;
+            result.sumSquares += d * d;
+        }
+    }
+
+    Reduction::Result initialResult(const double* data)
+    {
+        return {data[0], 0, data[0], 0, 0., 0.};
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Combine per lane minimums/maximums, preferring the earliest index on ties
+    // so all kernels agree with std::min_element and std::max_element
+    ////////////////////////////////////////////////////////////////////////////
+    void combineLanes(const double* mins, const double* minIndices,
+        const double* maxs, const double* maxIndices, std::size_t lanes,
+        Reduction::Result& result)
+    {
+        for (std::size_t lane = 0; lane < lanes; ++lane)
+        {
+            auto minIndex = static_cast<std::size_t>(minIndices[lane]);
+            if (mins[lane] < result.min || (mins[lane] == result.min && minIndex < result.argMin))
+            {
+                result.min = mins[lane];
+                result.argMin = minIndex;
+            }
+
+            auto maxIndex = static_cast<std::size_t>(maxIndices[lane]);
+            if (maxs[lane] > result.max || (maxs[lane] == result.max && maxIndex < result.argMax))
+            {
+                result.max = maxs[lane];
+                result.argMax = maxIndex;
+            }
+        }
+    }
+
+#if defined(BCSTATS_X86)
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Two lanes at a time, indices are tracked as doubles (exact up to 2^53)
+    ////////////////////////////////////////////////////////////////////////////
+    Reduction::Result reduceSSE2(const double* data, std::size_t count, double shift)
+    {
+        auto result = initialResult(data);
+        std::size_t i = 0;
+
+        if (count >= 2)
+        {
+            auto vshift = _mm_set1_pd(shift);
+            auto vmin = _mm_set1_pd(data[0]);
+            auto vmax = vmin;
+            auto minIndex = _mm_setzero_pd();
+            auto maxIndex = minIndex;
+            auto index = _mm_set_pd(1., 0.);
+            auto step = _mm_set1_pd(2.);
+            auto sum = _mm_setzero_pd();
+            auto sumSquares = _mm_setzero_pd();
+
+            for (; i + 2 <= count; i += 2)
+            {
+                auto x = _mm_loadu_pd(data + i);
+
+                // No blend in SSE2, so select with masks
+                auto less = _mm_cmplt_pd(x, vmin);
+                vmin = _mm_or_pd(_mm_and_pd(less, x), _mm_andnot_pd(less, vmin));
+                minIndex = _mm_or_pd(_mm_and_pd(less, index), _mm_andnot_pd(less, minIndex));
+
+                auto greater = _mm_cmpgt_pd(x, vmax);
+                vmax = _mm_or_pd(_mm_and_pd(greater, x), _mm_andnot_pd(greater, vmax));
+                maxIndex = _mm_or_pd(_mm_and_pd(greater, index), _mm_andnot_pd(greater, maxIndex));
+
+                auto d = _mm_sub_pd(x, vshift);
+                sum = _mm_add_pd(sum, d);
+                sumSquares = _mm_add_pd(sumSquares, _mm_mul_pd(d, d));
+
+                index = _mm_add_pd(index, step);
+            }
+
+            alignas(16) double mins[2], minIndices[2], maxs[2], maxIndices[2], sums[2], squares[2];
+            _mm_store_pd(mins, vmin);
+            _mm_store_pd(minIndices, minIndex);
+            _mm_store_pd(maxs, vmax);
+            _mm_store_pd(maxIndices, maxIndex);
+            _mm_store_pd(sums, sum);
+            _mm_store_pd(squares, sumSquares);
+
+            combineLanes(mins, minIndices, maxs, maxIndices, 2, result);
+            result.sum = sums[0] + sums[1];
+            result.sumSquares = squares[0] + squares[1];
+        }
+
+        reduceScalar(data, i, count, shift, result);
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Four lanes at a time, indices are tracked as doubles (exact up to 2^53)
+    ////////////////////////////////////////////////////////////////////////////
+    BCSTATS_TARGET_AVX2
+    Reduction::Result reduceAVX2(const double* data, std::size_t count, double shift)
+    {
+        auto result = initialResult(data);
+        std::size_t i = 0;
+
+        if (count >= 4)
+        {
+            auto vshift = _mm256_set1_pd(shift);
+            auto vmin = _mm256_set1_pd(data[0]);
+            auto vmax = vmin;
+            auto minIndex = _mm256_setzero_pd();
+            auto maxIndex = minIndex;
+            auto index = _mm256_set_pd(3., 2., 1., 0.);
+            auto step = _mm256_set1_pd(4.);
+            auto sum = _mm256_setzero_pd();
+            auto sumSquares = _mm256_setzero_pd();
+
+            for (; i + 4 <= count; i += 4)
+            {
+                auto x = _mm256_loadu_pd(data + i);
+
+                auto less = _mm256_cmp_pd(x, vmin, _CMP_LT_OQ);
+                vmin = _mm256_blendv_pd(vmin, x, less);
+                minIndex = _mm256_blendv_pd(minIndex, index, less);
+
+                auto greater = _mm256_cmp_pd(x, vmax, _CMP_GT_OQ);
+                vmax = _mm256_blendv_pd(vmax, x, greater);
+                maxIndex = _mm256_blendv_pd(maxIndex, index, greater);
+
+                auto d = _mm256_sub_pd(x, vshift);
+                sum = _mm256_add_pd(sum, d);
+                sumSquares = _mm256_add_pd(sumSquares, _mm256_mul_pd(d, d));
+
+                index = _mm256_add_pd(index, step);
+            }
+
+            alignas(32) double mins[4], minIndices[4], maxs[4], maxIndices[4], sums[4], squares[4];
+            _mm256_store_pd(mins, vmin);
+            _mm256_store_pd(minIndices, minIndex);
+            _mm256_store_pd(maxs, vmax);
+            _mm256_store_pd(maxIndices, maxIndex);
+            _mm256_store_pd(sums, sum);
+            _mm256_store_pd(squares, sumSquares);
+
+            combineLanes(mins, minIndices, maxs, maxIndices, 4, result);
+            result.sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+            result.sumSquares = (squares[0] + squares[1]) + (squares[2] + squares[3]);
+        }
+
+        reduceScalar(data, i, count, shift, result);
+        return result;
+    }
+
+    bool cpuHasAVX2()
+    {
+    #if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // The OS has to save the ymm registers too
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Reduction::Result Reduction::run(const double* data, std::size_t count, double shift)
+{
+    static const auto kernel = bestKernel();
+    return run(data, count, shift, kernel);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Reduction::Result Reduction::run(const double* data, std::size_t count, double shift, Kernel kernel)
+{
+    switch (kernel)
+    {
+#if defined(BCSTATS_X86)
+        case Kernel::AVX2:
+            return reduceAVX2(data, count, shift);
+        case Kernel::SSE2:
+            return reduceSSE2(data, count, shift);
+#endif
+        default:
+        {
+            auto result = initialResult(data);
+            reduceScalar(data, 0, count, shift, result);
+            return result;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Reduction::Kernel Reduction::bestKernel()
+{
+    if (isSupported(Kernel::AVX2))
+    {
+        return Kernel::AVX2;
+    }
+    if (isSupported(Kernel::SSE2))
+    {
+        return Kernel::SSE2;
+    }
+    return Kernel::Scalar;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Reduction::isSupported(Kernel kernel)
+{
+    switch (kernel)
+    {
+#if defined(BCSTATS_X86)
+        // SSE2 is part of x86-64
+        case Kernel::SSE2:
+            return true;
+        case Kernel::AVX2:
+        {
+            static const bool avx2 = cpuHasAVX2();
+            return avx2;
+        }
+#endif
+        case Kernel::Scalar:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+// Fused single pass reduction over an array of prices
+//
+// Finds the min and max (and where they are), along with the sum and sum of
+// squares, in one pass. The widest SIMD kernel the cpu supports is picked at
+// runtime.
+//
+// Sums are taken of the values minus a shift, which should be something close
+// to the data (the first value will do). This keeps the sum of squares from
+// swamping the variance when the spread is small compared to the prices.
+////////////////////////////////////////////////////////////////////////////////
+class Reduction final
+{
+    public:
+
+    // Instruction sets with a kernel
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    struct Result
+    {
+        double      min;
+        std::size_t argMin;
+        double      max;
+        std::size_t argMax;
+        double      sum;        // Sum of (x - shift)
+        double      sumSquares; // Sum of (x - shift)^2
+    };
+
+    // Reduce the data with the best kernel available, data must not be empty
+    static Result run(const double* data, std::size_t count, double shift);
+
+    // Reduce the data with a specific kernel, which must be supported
+    static Result run(const double* data, std::size_t count, double shift, Kernel kernel);
+
+    // The best kernel the cpu supports
+    static Kernel bestKernel();
+
+    // Whether the cpu supports a kernel
+    static bool isSupported(Kernel kernel);
+};
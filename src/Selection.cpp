@@ -0,0 +1,252 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "Parallel.hpp"
+#include "Selection.hpp"
+
+namespace
+{
+    constexpr std::uint64_t SignBit = std::uint64_t(1) << 63;
+
+    // Radix digit size, and so the number of buckets per pass
+    constexpr int DigitBits = 16;
+    constexpr std::size_t Buckets = std::size_t(1) << DigitBits;
+
+    // Smallest chunk worth handing to a thread
+    constexpr std::size_t MinChunk = 64 * 1024;
+
+    // Map a double to an integer with the same ordering
+    inline std::uint64_t orderedKey(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits & SignBit ? ~bits : bits | SignBit;
+    }
+
+    inline double fromOrderedKey(std::uint64_t key)
+    {
+        auto bits = key & SignBit ? key & ~SignBit : ~key;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Selection::kthSmallest(double* data, std::size_t count, std::size_t k)
+{
+    std::nth_element(data, data + k, data + count);
+    return data[k];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Selection::median(double* data, std::size_t count)
+{
+    auto upper = kthSmallest(data, count, count / 2);
+    if (count % 2)
+    {
+        return upper;
+    }
+
+    // nth_element leaves everything below the upper middle value in front of
+    // it, so the lower middle value is the largest of those
+    auto lower = *std::max_element(data, data + count / 2);
+    return (lower + upper) / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Selection::parallelKthSmallest(const double* data, std::size_t count, std::size_t k, unsigned threads)
+{
+    threads = std::max(1u, threads);
+    std::vector<std::vector<std::size_t>> histograms(threads, std::vector<std::size_t>(Buckets));
+
+    // Key bits decided so far, and which bits those are
+    std::uint64_t prefix = 0;
+    std::uint64_t mask = 0;
+
+    // Each pass narrows down one digit of the answer's key, counting only the
+    // values that match the digits already decided
+    for (int shift = 64 - DigitBits; shift >= 0; shift -= DigitBits)
+    {
+        auto chunks = Parallel::forChunks(threads, count, MinChunk,
+        [&](std::size_t begin, std::size_t end, std::size_t chunk)
+        {
+            auto& histogram = histograms[chunk];
+            std::fill(histogram.begin(), histogram.end(), 0);
+            for (auto i = begin; i < end; ++i)
+            {
+                auto key = orderedKey(data[i]);
+                if ((key & mask) == prefix)
+                {
+                    ++histogram[(key >> shift) & (Buckets - 1)];
+                }
+            }
+        });
+
+        // Find the bucket holding the k-th value
+        std::size_t bucket = 0;
+        for (; bucket < Buckets - 1; ++bucket)
+        {
+            std::size_t total = 0;
+            for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+            {
+                total += histograms[chunk][bucket];
+            }
+
+            if (k < total)
+            {
+                break;
+            }
+            k -= total;
+        }
+
+        prefix |= static_cast<std::uint64_t>(bucket) << shift;
+        mask |= static_cast<std::uint64_t>(Buckets - 1) << shift;
+    }
+
+    return fromOrderedKey(prefix);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Selection::parallelMedian(const double* data, std::size_t count, unsigned threads)
+{
+    threads = std::max(1u, threads);
+    auto lower = parallelKthSmallest(data, count, (count - 1) / 2, threads);
+    if (count % 2)
+    {
+        return lower;
+    }
+
+    // The upper middle value is either a repeat of the lower one, or the
+    // smallest value above it
+    struct Partial
+    {
+        std::size_t notGreater = 0;
+        double      nextGreater = std::numeric_limits<double>::infinity();
+    };
+    std::vector<Partial> partials(threads);
+
+    auto chunks = Parallel::forChunks(threads, count, MinChunk,
+    [&](std::size_t begin, std::size_t end, std::size_t chunk)
+    {
+        Partial partial;
+        for (auto i = begin; i < end; ++i)
+        {
+            if (data[i] <= lower)
+            {
+                ++partial.notGreater;
+            }
+            else if (data[i] < partial.nextGreater)
+            {
+                partial.nextGreater = data[i];
+            }
+        }
+        partials[chunk] = partial;
+    });
+
+    Partial total;
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        total.notGreater += partials[chunk].notGreater;
+        total.nextGreater = std::min(total.nextGreater, partials[chunk].nextGreater);
+    }
+
+    auto upper = total.notGreater > count / 2 ? lower : total.nextGreater;
+    return (lower + upper) / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Selection::streamingKthSmallest(const Blocks& blocks, std::size_t k)
+{
+    std::vector<std::size_t> histogram(Buckets);
+    std::uint64_t prefix = 0;
+    std::uint64_t mask = 0;
+
+    // The same digit by digit narrowing as parallelKthSmallest, one pass over
+    // the blocks per digit
+    for (int shift = 64 - DigitBits; shift >= 0; shift -= DigitBits)
+    {
+        std::fill(histogram.begin(), histogram.end(), 0);
+        blocks([&](const double* data, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                auto key = orderedKey(data[i]);
+                if ((key & mask) == prefix)
+                {
+                    ++histogram[(key >> shift) & (Buckets - 1)];
+                }
+            }
+        });
+
+        std::size_t bucket = 0;
+        for (; bucket < Buckets - 1 && k >= histogram[bucket]; ++bucket)
+        {
+            k -= histogram[bucket];
+        }
+
+        prefix |= static_cast<std::uint64_t>(bucket) << shift;
+        mask |= static_cast<std::uint64_t>(Buckets - 1) << shift;
+    }
+
+    return fromOrderedKey(prefix);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double Selection::streamingMedian(const Blocks& blocks, std::size_t count)
+{
+    auto lower = streamingKthSmallest(blocks, (count - 1) / 2);
+    if (count % 2)
+    {
+        return lower;
+    }
+
+    // The upper middle value is either a repeat of the lower one, or the
+    // smallest value above it
+    std::size_t notGreater = 0;
+    auto nextGreater = std::numeric_limits<double>::infinity();
+    blocks([&](const double* data, std::size_t blockCount)
+    {
+        for (std::size_t i = 0; i < blockCount; ++i)
+        {
+            if (data[i] <= lower)
+            {
+                ++notGreater;
+            }
+            else if (data[i] < nextGreater)
+            {
+                nextGreater = data[i];
+            }
+        }
+    });
+
+    auto upper = notGreater > count / 2 ? lower : nextGreater;
+    return (lower + upper) / 2;
+}
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+////////////////////////////////////////////////////////////////////////////////
+// Order statistics without sorting
+////////////////////////////////////////////////////////////////////////////////
+class Selection final
+{
+    public:
+
+    // The k-th smallest value (zero based) in expected linear time
+    // The data is reordered in place, k must be less than count
+    static double kthSmallest(double* data, std::size_t count, std::size_t k);
+
+    // The median, averaging the middle two values for an even count
+    // The data is reordered in place, count must not be zero
+    static double median(double* data, std::size_t count);
+
+    // As above, but without modifying the data, spread over up to the given
+    // number of threads. This is a radix select over the bits of the values,
+    // so it makes a fixed number of passes and needs no copy of the data
+    static double parallelKthSmallest(const double* data, std::size_t count, std::size_t k, unsigned threads);
+    static double parallelMedian(const double* data, std::size_t count, unsigned threads);
+
+    // Calls its argument with each block of a series in turn
+    using Blocks = std::function<void(const std::function<void(const double* data, std::size_t count)>&)>;
+
+    // As above, for series only available a block at a time, such as
+    // compressed ones. Blocks are visited a fixed number of times, and never
+    // need to be in memory together
+    static double streamingKthSmallest(const Blocks& blocks, std::size_t k);
+    static double streamingMedian(const Blocks& blocks, std::size_t count);
+};
@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+#include "Reduction.hpp"
+#include "StatsAccumulator.hpp"
+
+namespace
+{
+    // Values per block handed to the SIMD reduction. Small enough that the
+    // shifted sums within a block stay accurate, big enough to amortise the
+    // merge
+    constexpr std::size_t BlockSize = 4096;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsAccumulator::add(double value, std::size_t index)
+{
+    if (!m_count || value < m_min || (value == m_min && index < m_argMin))
+    {
+        m_min = value;
+        m_argMin = index;
+    }
+    if (!m_count || value > m_max || (value == m_max && index < m_argMax))
+    {
+        m_max = value;
+        m_argMax = index;
+    }
+
+    // Welford's update
+    ++m_count;
+    auto delta = value - mean();
+    kahanAdd(m_mean, m_meanCompensation, delta / m_count);
+    kahanAdd(m_m2, m_m2Compensation, delta * (value - mean()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsAccumulator::add(const double* data, std::size_t count, std::size_t firstIndex)
+{
+    for (std::size_t offset = 0; offset < count; offset += BlockSize)
+    {
+        auto blockCount = std::min(BlockSize, count - offset);
+        auto block = data + offset;
+
+        // Reduce the block relative to something close to its values, then
+        // turn the shifted sums into a partial state and merge it in
+        auto shift = m_count ? mean() : block[0];
+        auto reduction = Reduction::run(block, blockCount, shift);
+
+        StatsAccumulator partial;
+        partial.m_count = blockCount;
+        partial.m_mean = shift + reduction.sum / blockCount;
+        partial.m_m2 = std::max(0., reduction.sumSquares - reduction.sum * reduction.sum / blockCount);
+        partial.m_min = reduction.min;
+        partial.m_argMin = firstIndex + offset + reduction.argMin;
+        partial.m_max = reduction.max;
+        partial.m_argMax = firstIndex + offset + reduction.argMax;
+
+        merge(partial);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsAccumulator::merge(const StatsAccumulator& other)
+{
+    if (!other.m_count)
+    {
+        return;
+    }
+
+    if (!m_count)
+    {
+        *this = other;
+        return;
+    }
+
+    if (other.m_min < m_min || (other.m_min == m_min && other.m_argMin < m_argMin))
+    {
+        m_min = other.m_min;
+        m_argMin = other.m_argMin;
+    }
+    if (other.m_max > m_max || (other.m_max == m_max && other.m_argMax < m_argMax))
+    {
+        m_max = other.m_max;
+        m_argMax = other.m_argMax;
+    }
+
+    // Chan et al. pairwise combination
+    auto count = m_count + other.m_count;
+    auto delta = other.mean() - mean();
+    auto weight = static_cast<double>(other.m_count) / count;
+
+    kahanAdd(m_m2, m_m2Compensation, other.m_m2 - other.m_m2Compensation);
+    kahanAdd(m_m2, m_m2Compensation, delta * delta * m_count * weight);
+    kahanAdd(m_mean, m_meanCompensation, delta * weight);
+    m_count = count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsAccumulator::count() const
+{
+    return m_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double StatsAccumulator::mean() const
+{
+    return m_mean - m_meanCompensation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double StatsAccumulator::variance() const
+{
+    if (m_count < 2)
+    {
+        return 0.;
+    }
+    return std::max(0., m_m2 - m_m2Compensation) / (m_count - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double StatsAccumulator::standardDeviation() const
+{
+    return std::sqrt(variance());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double StatsAccumulator::min() const
+{
+    return m_min;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsAccumulator::argMin() const
+{
+    return m_argMin;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double StatsAccumulator::max() const
+{
+    return m_max;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsAccumulator::argMax() const
+{
+    return m_argMax;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsAccumulator::kahanAdd(double& sum, double& compensation, double value)
+{
+    auto y = value - compensation;
+    auto t = sum + y;
+    compensation = (t - sum) - y;
+    sum = t;
+}
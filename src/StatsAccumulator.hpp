@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////
+// Single pass, numerically stable accumulator for summary statistics
+//
+// Tracks count, mean, variance, min and max (and where they were seen) using
+// Welford's updates with compensated summation. Partial states from separate
+// chunks of data can be merged (Chan et al.), so the same accumulator serves
+// sequential, parallel and incremental computation.
+////////////////////////////////////////////////////////////////////////////////
+class StatsAccumulator final
+{
+    public:
+
+    // Add a single value, index being its position in the series
+    void add(double value, std::size_t index);
+
+    // Add a contiguous block of values, the first being at firstIndex in the
+    // series. Much faster than adding them one at a time
+    void add(const double* data, std::size_t count, std::size_t firstIndex);
+
+    // Merge in the state from another accumulator
+    void merge(const StatsAccumulator& other);
+
+    // Number of values added
+    std::size_t count() const;
+
+    // Mean of the values added
+    double mean() const;
+
+    // Sample variance of the values added (zero for fewer than two)
+    double variance() const;
+
+    // Sample standard deviation of the values added
+    double standardDeviation() const;
+
+    // Smallest and largest values added, and their indices. On ties the
+    // lowest index wins
+    double min() const;
+    std::size_t argMin() const;
+    double max() const;
+    std::size_t argMax() const;
+
+    private:
+    // Add to a compensated sum
+    static void kahanAdd(double& sum, double& compensation, double value);
+
+    std::size_t m_count = 0;
+    double      m_mean = 0.;
+    double      m_meanCompensation = 0.;
+    double      m_m2 = 0.;  // Sum of squared differences from the mean
+    double      m_m2Compensation = 0.;
+    double      m_min = 0.;
+    std::size_t m_argMin = 0;
+    double      m_max = 0.;
+    std::size_t m_argMax = 0;
+};
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "StatsCache.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+bool StatsCache::Key::operator==(const Key& other) const
+{
+    return from == other.from && to == other.to && source == other.source;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsCache::KeyHash::operator()(const Key& key) const
+{
+    auto hash = std::hash<std::string>()(key.source);
+    for (auto value : {key.from, key.to})
+    {
+        hash ^= std::hash<std::int64_t>()(value) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StatsCache::StatsCache(std::size_t capacity) :
+m_capacity(capacity)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<HistoryAnalyzer::Stats> StatsCache::find(const Key& key, std::uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_index.find(key);
+    if (found == m_index.end())
+    {
+        ++m_misses;
+        return {};
+    }
+
+    // Computed from data that's since changed
+    auto entry = found->second;
+    if (entry->generation != generation)
+    {
+        m_entries.erase(entry);
+        m_index.erase(found);
+        ++m_misses;
+        return {};
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    ++m_hits;
+    return entry->stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsCache::insert(const Key& key, std::uint64_t generation, const HistoryAnalyzer::Stats& stats)
+{
+    if (!m_capacity)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_index.find(key);
+    if (found != m_index.end())
+    {
+        auto entry = found->second;
+        entry->generation = generation;
+        entry->stats = stats;
+        m_entries.splice(m_entries.begin(), m_entries, entry);
+        return;
+    }
+
+    if (m_entries.size() == m_capacity)
+    {
+        m_index.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+
+    m_entries.push_front({key, generation, stats});
+    m_index.emplace(key, m_entries.begin());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+optional<HistoryAnalyzer::Stats> StatsCache::get(const Key& key, std::uint64_t generation,
+    const std::function<optional<HistoryAnalyzer::Stats>()>& compute)
+{
+    auto stats = find(key, generation);
+    if (stats)
+    {
+        return stats;
+    }
+
+    // Computed without the lock, so a slow query doesn't hold up others
+    stats = compute();
+    if (stats)
+    {
+        insert(key, generation, *stats);
+    }
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index.clear();
+    m_entries.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsCache::capacity() const
+{
+    return m_capacity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
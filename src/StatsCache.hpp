@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "HistoryAnalyzer.hpp"
+#include "Optional.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// Least recently used cache of stats, keyed by source and date range
+//
+// Each entry remembers the generation of the data it was computed from (see
+// HistoryAnalyzer::generation()), so once the series is appended to or
+// reloaded its entries miss and are replaced. Safe to share between threads.
+////////////////////////////////////////////////////////////////////////////////
+class StatsCache final
+{
+    public:
+    struct Key
+    {
+        std::string     source;
+        std::int64_t    from;
+        std::int64_t    to;
+
+        bool operator==(const Key& other) const;
+    };
+
+    // Holds at most capacity entries, 0 caching nothing
+    StatsCache(std::size_t capacity = 1024);
+
+    // Stats cached for a query on this generation of the data
+    // Returns nothing if there aren't any
+    optional<HistoryAnalyzer::Stats> find(const Key& key, std::uint64_t generation);
+
+    // Cache stats for a query, dropping the least recently used entry if full
+    void insert(const Key& key, std::uint64_t generation, const HistoryAnalyzer::Stats& stats);
+
+    // Cached stats for a query, otherwise compute and cache them. Nothing
+    // computed isn't cached
+    optional<HistoryAnalyzer::Stats> get(const Key& key, std::uint64_t generation,
+        const std::function<optional<HistoryAnalyzer::Stats>()>& compute);
+
+    // Drop every entry, keeping the counters
+    void clear();
+
+    std::size_t size() const;
+    std::size_t capacity() const;
+
+    // Lookups that found stats, and that didn't
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+    private:
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+        Key                     key;
+        std::uint64_t           generation;
+        HistoryAnalyzer::Stats  stats;
+    };
+
+    using Entries = std::list<Entry>;
+
+    const std::size_t   m_capacity;
+    mutable std::mutex  m_mutex;
+
+    // Most recently used first
+    Entries             m_entries;
+    std::unordered_map<Key, Entries::iterator, KeyHash> m_index;
+
+    std::size_t         m_hits = 0;
+    std::size_t         m_misses = 0;
+};
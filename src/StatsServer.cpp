@@ -0,0 +1,363 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <json/json.hpp>
+
+#include "DateTime.hpp"
+#include "HistorySource.hpp"
+#include "StatsServer.hpp"
+
+namespace
+{
+    nlohmann::json toJson(const HistoryAnalyzer::DataPoint& point)
+    {
+        return {{"time", DateTime::format(point.time)}, {"price", point.price}};
+    }
+
+    nlohmann::json toJson(const HistoryAnalyzer::Stats& stats)
+    {
+        return
+        {
+            {"samples", stats.dataSize},
+            {"highest", toJson(stats.highest)},
+            {"lowest", toJson(stats.lowest)},
+            {"mean", stats.meanPrice},
+            {"median", stats.medianPrice},
+            {"standardDeviation", stats.standardDeviation}
+        };
+    }
+
+    void respond(httplib::Response& response, int status, const nlohmann::json& body)
+    {
+        response.status = status;
+        response.set_content(body.dump(), "application/json");
+    }
+
+    void respondError(httplib::Response& response, int status, const std::string& message)
+    {
+        respond(response, status, {{"error", message}});
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Read the from and to parameters as a time range, open ended where
+    // either is missing. A plain date for to covers the whole of that day
+    // Returns false if either isn't a valid date
+    ////////////////////////////////////////////////////////////////////////////
+    bool parseRange(const httplib::Request& request, std::int64_t& from, std::int64_t& to)
+    {
+        from = std::numeric_limits<std::int64_t>::min();
+        to = std::numeric_limits<std::int64_t>::max();
+
+        if (request.has_param("from") && !DateTime::parse(request.get_param_value("from"), from))
+        {
+            return false;
+        }
+
+        if (request.has_param("to") && !DateTime::parseEnd(request.get_param_value("to"), to))
+        {
+            return false;
+        }
+        return true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StatsServer::StatsServer(std::unique_ptr<HistorySource> source, unsigned threads, std::size_t cacheCapacity) :
+m_source(std::move(source)),
+m_identity(m_source->identity()),
+m_threads(threads),
+m_cache(cacheCapacity)
+{
+    m_server.Get("/stats", [this](const httplib::Request& request, httplib::Response& response)
+    {
+        handleStats(request, response);
+    });
+    m_server.Get("/quantile", [this](const httplib::Request& request, httplib::Response& response)
+    {
+        handleQuantile(request, response);
+    });
+    m_server.Get("/status", [this](const httplib::Request& request, httplib::Response& response)
+    {
+        handleStatus(request, response);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+StatsServer::~StatsServer()
+{
+    stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::setRefreshInterval(std::int64_t seconds)
+{
+    m_refreshInterval = seconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::setCompressed(bool compressed)
+{
+    m_compressed = compressed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::setThreadPool(std::size_t threads, std::size_t maxQueued)
+{
+    m_server.set_thread_pool(threads, maxQueued);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool StatsServer::load()
+{
+    // Built off to the side, so requests carry on with the old snapshot
+    auto next = std::make_shared<Snapshot>();
+    next->analyzer.setThreadCount(m_threads);
+
+    if (!m_source->read(next->analyzer))
+    {
+        std::cout << "Failed to load history" << (snapshot() ? ", still serving the previous data" : "") << std::endl;
+        return false;
+    }
+
+    // Summarize up front so the first request doesn't pay for it
+    auto& analyzer = next->analyzer;
+    next->summary = analyzer.analyze();
+    next->generation = analyzer.generation();
+    if (analyzer.size())
+    {
+        next->first = analyzer.getTimes()[0];
+        next->last = analyzer.getTimes()[analyzer.size() - 1];
+    }
+
+    if (m_compressed)
+    {
+        next->series = std::make_unique<CompressedSeries>(analyzer);
+        analyzer.assign({}, {});
+    }
+    else
+    {
+        next->index = std::make_unique<HistoryIndex>(analyzer);
+    }
+    next->loaded = static_cast<std::int64_t>(std::time(nullptr));
+
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+    ++m_loads;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int StatsServer::bind(const std::string& host, int port)
+{
+    return m_server.bind_to_port(host.c_str(), port);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool StatsServer::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_refreshMutex);
+        m_stopping = false;
+    }
+
+    std::thread refresher;
+    if (m_refreshInterval > 0)
+    {
+        refresher = std::thread(&StatsServer::refresh, this);
+    }
+
+    auto result = m_server.listen_after_bind();
+
+    {
+        std::lock_guard<std::mutex> lock(m_refreshMutex);
+        m_stopping = true;
+    }
+    m_refreshCondition.notify_all();
+
+    if (refresher.joinable())
+    {
+        refresher.join();
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::stop()
+{
+    m_server.stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool StatsServer::isRunning() const
+{
+    return m_server.is_running();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t StatsServer::loadCount() const
+{
+    return m_loads;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const StatsCache& StatsServer::cache() const
+{
+    return m_cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const StatsServer::Snapshot> StatsServer::snapshot() const
+{
+    return std::atomic_load(&m_snapshot);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::refresh()
+{
+    std::unique_lock<std::mutex> lock(m_refreshMutex);
+    while (!m_refreshCondition.wait_for(lock, std::chrono::seconds(m_refreshInterval), [this] { return m_stopping; }))
+    {
+        // Load without the lock, so stopping doesn't wait on a slow source
+        lock.unlock();
+        load();
+        lock.lock();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::handleStats(const httplib::Request& request, httplib::Response& response) const
+{
+    auto current = snapshot();
+    if (!current)
+    {
+        respondError(response, 503, "No history loaded");
+        return;
+    }
+
+    std::int64_t from, to;
+    if (!parseRange(request, from, to))
+    {
+        respondError(response, 400, "Dates must be in the format YYYY-MM-DD");
+        return;
+    }
+
+    auto stats = m_cache.get({m_identity, from, to}, current->generation,
+    [&request, &current, from, to]() -> optional<HistoryAnalyzer::Stats>
+    {
+        if (!request.has_param("from") && !request.has_param("to"))
+        {
+            return current->summary;
+        }
+        if (current->series)
+        {
+            return current->series->analyze(from, to);
+        }
+        return current->index->query(from, to);
+    });
+
+    if (!stats)
+    {
+        respondError(response, 404, "No data found in range");
+        return;
+    }
+    respond(response, 200, toJson(*stats));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::handleQuantile(const httplib::Request& request, httplib::Response& response) const
+{
+    auto current = snapshot();
+    if (!current)
+    {
+        respondError(response, 503, "No history loaded");
+        return;
+    }
+
+    std::int64_t from, to;
+    if (!parseRange(request, from, to))
+    {
+        respondError(response, 400, "Dates must be in the format YYYY-MM-DD");
+        return;
+    }
+
+    double q = 0.;
+    try
+    {
+        std::size_t used = 0;
+        auto text = request.get_param_value("q");
+        q = std::stod(text, &used);
+        if (used != text.size() || !(q >= 0. && q <= 1.))
+        {
+            throw std::invalid_argument(text);
+        }
+    }
+    catch (const std::exception&)
+    {
+        respondError(response, 400, "q must be a number from 0 to 1");
+        return;
+    }
+
+    auto quantile = current->series ? current->series->quantile(from, to, q) : current->index->quantile(from, to, q);
+    if (!quantile)
+    {
+        respondError(response, 404, "No data found in range");
+        return;
+    }
+    respond(response, 200, {{"q", q}, {"price", *quantile}});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StatsServer::handleStatus(const httplib::Request&, httplib::Response& response) const
+{
+    auto current = snapshot();
+    if (!current)
+    {
+        respondError(response, 503, "No history loaded");
+        return;
+    }
+
+    nlohmann::json status = {
+        {"samples", current->summary.dataSize},
+        {"loaded", DateTime::format(current->loaded)},
+        {"loads", loadCount()},
+        {"cache",
+        {
+            {"size", m_cache.size()},
+            {"capacity", m_cache.capacity()},
+            {"hits", m_cache.hits()},
+            {"misses", m_cache.misses()}
+        }}
+    };
+    if (current->summary.dataSize)
+    {
+        status["from"] = DateTime::format(current->first);
+        status["to"] = DateTime::format(current->last);
+    }
+    respond(response, 200, status);
+}
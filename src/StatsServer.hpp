@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <http/httplib.hpp>
+
+#include "CompressedSeries.hpp"
+#include "HistoryAnalyzer.hpp"
+#include "HistoryIndex.hpp"
+#include "StatsCache.hpp"
+
+class HistorySource;
+
+////////////////////////////////////////////////////////////////////////////////
+// Serves stats over HTTP from history held in memory
+//
+// The history is loaded once and indexed, so each request is answered
+// without fetching or parsing anything. Endpoints:
+//   /stats?from=&to=               stats for a date range, or everything
+//   /quantile?q=&from=&to=         a price quantile for a date range
+//   /status                        what's loaded and when
+//
+// A background thread reloads the history from the source every refresh
+// interval. Requests hold on to the snapshot they started with, and new
+// data is swapped in atomically, so readers never wait for a reload.
+//
+// Stats for each range are cached until the data changes, so repeated
+// queries cost a hash lookup.
+//
+// Long histories can be held compressed instead of indexed, in a fraction of
+// the memory. Ranges are then answered by decoding only the blocks they
+// cover, so they cost time in the length of the range rather than its log.
+//
+// Connections are handled by a fixed pool of threads with a bounded queue,
+// so a burst of clients backs up in the listen backlog rather than
+// starting a thread each.
+////////////////////////////////////////////////////////////////////////////////
+class StatsServer final
+{
+    public:
+    // Caches stats for up to cacheCapacity ranges, 0 caching nothing
+    StatsServer(std::unique_ptr<HistorySource> source, unsigned threads = 1, std::size_t cacheCapacity = 1024);
+    ~StatsServer();
+
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+
+    // Seconds between reloads of the history, 0 to never reload
+    void setRefreshInterval(std::int64_t seconds);
+
+    // Hold the history compressed rather than indexed, from the next load
+    void setCompressed(bool compressed);
+
+    // Number of threads handling connections, and how many connections can
+    // wait for one before new connections are left unaccepted
+    void setThreadPool(std::size_t threads, std::size_t maxQueued);
+
+    // Load the history from the source, replacing what's being served
+    // Returns false if failure, leaving the current history in place
+    bool load();
+
+    // Bind to a port, 0 for any free port
+    // Returns the port bound to, or -1 if failure
+    int bind(const std::string& host, int port);
+
+    // Serve requests until stopped
+    // Returns false if failure
+    bool run();
+
+    // Stop serving, making run() return
+    void stop();
+
+    bool isRunning() const;
+
+    // Number of successful loads so far
+    std::size_t loadCount() const;
+
+    const StatsCache& cache() const;
+
+    private:
+    // Everything a request needs, replaced whole on reload
+    // Only one of index and series is kept, and the analyzer is emptied
+    // once the series is built from it
+    struct Snapshot
+    {
+        HistoryAnalyzer                     analyzer;
+        std::unique_ptr<HistoryIndex>       index;
+        std::unique_ptr<CompressedSeries>   series;
+        HistoryAnalyzer::Stats              summary = {};
+        std::uint64_t                       generation = 0;
+        std::int64_t                        first = 0;
+        std::int64_t                        last = 0;
+        std::int64_t                        loaded = 0;
+    };
+
+    std::shared_ptr<const Snapshot> snapshot() const;
+
+    // Reload every refresh interval until stopped
+    void refresh();
+
+    void handleStats(const httplib::Request& request, httplib::Response& response) const;
+    void handleQuantile(const httplib::Request& request, httplib::Response& response) const;
+    void handleStatus(const httplib::Request& request, httplib::Response& response) const;
+
+    const std::unique_ptr<HistorySource>    m_source;
+    const std::string                       m_identity;
+    const unsigned                          m_threads;
+    std::int64_t                            m_refreshInterval = 0;
+    std::atomic<bool>                       m_compressed{false};
+    httplib::Server                         m_server;
+
+    // Only accessed through std::atomic_load and std::atomic_store
+    std::shared_ptr<const Snapshot>         m_snapshot;
+    std::atomic<std::size_t>                m_loads{0};
+    mutable StatsCache                      m_cache;
+
+    std::mutex                              m_refreshMutex;
+    std::condition_variable                 m_refreshCondition;
+    bool                                    m_stopping = false;
+};
@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <bitset>
+
+#include "WaveletMatrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+WaveletMatrix::WaveletMatrix(std::vector<std::uint32_t> values, unsigned bits) :
+m_size(values.size())
+{
+    std::vector<std::uint32_t> partitioned(m_size);
+
+    for (unsigned level = 0; level < bits; ++level)
+    {
+        auto bit = bits - 1 - level;
+        BitVector bitVector(m_size);
+
+        std::size_t zeros = 0;
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            if ((values[i] >> bit) & 1)
+            {
+                bitVector.set(i);
+            }
+            else
+            {
+                ++zeros;
+            }
+        }
+        bitVector.buildRanks();
+
+        // Stable partition, zeros first
+        std::size_t zero = 0, one = zeros;
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            if ((values[i] >> bit) & 1)
+            {
+                partitioned[one++] = values[i];
+            }
+            else
+            {
+                partitioned[zero++] = values[i];
+            }
+        }
+        values.swap(partitioned);
+
+        m_levels.push_back(std::move(bitVector));
+        m_zeros.push_back(zeros);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t WaveletMatrix::size() const
+{
+    return m_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint32_t WaveletMatrix::kthSmallest(std::size_t begin, std::size_t end, std::size_t k) const
+{
+    std::uint32_t value = 0;
+    auto bits = static_cast<unsigned>(m_levels.size());
+
+    for (unsigned level = 0; level < bits; ++level)
+    {
+        auto& bitVector = m_levels[level];
+        auto zeroBegin = bitVector.rank0(begin);
+        auto zeroEnd = bitVector.rank0(end);
+        auto zeros = zeroEnd - zeroBegin;
+
+        if (k < zeros)
+        {
+            // Follow the zeros down
+            begin = zeroBegin;
+            end = zeroEnd;
+        }
+        else
+        {
+            // Follow the ones, which sit after every zero on the next level
+            k -= zeros;
+            begin = m_zeros[level] + (begin - zeroBegin);
+            end = m_zeros[level] + (end - zeroEnd);
+            value |= std::uint32_t(1) << (bits - 1 - level);
+        }
+    }
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+WaveletMatrix::BitVector::BitVector(std::size_t size) :
+m_words(size / 64 + 1)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WaveletMatrix::BitVector::set(std::size_t i)
+{
+    m_words[i / 64] |= std::uint64_t(1) << (i % 64);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void WaveletMatrix::BitVector::buildRanks()
+{
+    m_ranks.resize(m_words.size());
+    std::uint32_t rank = 0;
+    for (std::size_t i = 0; i < m_words.size(); ++i)
+    {
+        m_ranks[i] = rank;
+        rank += static_cast<std::uint32_t>(std::bitset<64>(m_words[i]).count());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t WaveletMatrix::BitVector::rank1(std::size_t i) const
+{
+    auto mask = (std::uint64_t(1) << (i % 64)) - 1;
+    return m_ranks[i / 64] + std::bitset<64>(m_words[i / 64] & mask).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t WaveletMatrix::BitVector::rank0(std::size_t i) const
+{
+    return i - rank1(i);
+}
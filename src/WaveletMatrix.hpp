@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// MIT License
+// 
+// Copyright (c) 2018 Jonny Paton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+// Wavelet matrix over a sequence of integers for range order statistics
+//
+// Each level stores one bit of every value, most significant first, with the
+// sequence stably partitioned by that bit between levels. Finding the k-th
+// smallest value in a range then takes one rank query per level, so
+// O(log sigma) time without touching the values themselves
+////////////////////////////////////////////////////////////////////////////////
+class WaveletMatrix final
+{
+    public:
+    WaveletMatrix() = default;
+
+    // Build over values, all of which must be less than 2^bits
+    WaveletMatrix(std::vector<std::uint32_t> values, unsigned bits);
+
+    std::size_t size() const;
+
+    // The k-th (zero based) smallest value at positions [begin, end)
+    // k must be less than end - begin
+    std::uint32_t kthSmallest(std::size_t begin, std::size_t end, std::size_t k) const;
+
+    private:
+    // Bits with constant time rank queries
+    class BitVector final
+    {
+        public:
+        BitVector() = default;
+        BitVector(std::size_t size);
+
+        void set(std::size_t i);
+        // Call once all bits are set, before rank queries
+        void buildRanks();
+
+        // Number of set bits before position i
+        std::size_t rank1(std::size_t i) const;
+        std::size_t rank0(std::size_t i) const;
+
+        private:
+        std::vector<std::uint64_t> m_words;
+        // Set bits before each word
+        std::vector<std::uint32_t> m_ranks;
+    };
+
+    std::size_t             m_size = 0;
+    std::vector<BitVector>  m_levels;
+    // Number of zeros on each level, where the ones start once partitioned
+    std::vector<std::size_t> m_zeros;
+};
@@ -22,16 +22,47 @@
 // SOFTWARE.
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <regex>
+#include <sstream>
 
 #include <cxxopts/cxxopts.hpp>
 
+#include "BatchAnalyzer.hpp"
+#include "DateTime.hpp"
+#include "HTTPCache.hpp"
+#include "HistorySourceBinary.hpp"
 #include "HistorySourceFile.hpp"
 #include "HistorySourceHTTP.hpp"
+#include "HistorySourceHTTPChunked.hpp"
+#include "HistorySourceStore.hpp"
 #include "HistoryAnalyzer.hpp"
+#include "OutputWriter.hpp"
+#include "Profiler.hpp"
+#include "StatsServer.hpp"
 
 using std::operator ""s;
 
+namespace
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // Read the dates given for --range as the times to analyze, a plain date
+    // for the end covering the whole of that day
+    // Returns false, having said why, if they aren't two valid dates
+    ////////////////////////////////////////////////////////////////////////////
+    bool parseRange(const std::vector<std::string>& dates, std::int64_t& from, std::int64_t& to)
+    {
+        if (dates.size() != 2 || !DateTime::parse(dates[0], from) || !DateTime::parseEnd(dates[1], to))
+        {
+            std::cout << "Please provide 2 dates for range, in the format \"YYYY-MM-DD YYYY-MM-DD\"" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
 int main(int argc, const char *argv[])
 {
     // Set up the program options
@@ -42,7 +73,28 @@ int main(int argc, const char *argv[])
     .add_options()
     ("h,help", "Show this help")
     ("v,verbose", "Verbose output")
-    ("f,file", "JSON file containing history data to analyze", cxxopts::value<std::string>())
+    ("o,output", "Format to write stats and data in (text, json, csv, ndjson)", cxxopts::value<std::string>()->default_value("text"))
+    ("profile", "Report time, CPU, allocations and peak memory for each phase of the run")
+    ("f,file", "JSON or binary file containing history data to analyze", cxxopts::value<std::string>())
+    ("b,batch", "Files, directories or quoted wildcard patterns of history files to analyze together, comma separated or repeated", cxxopts::value<std::vector<std::string>>())
+    ("j,jobs", "Files to work on at once in batch mode, 0 for one per core", cxxopts::value<unsigned>()->default_value("0"))
+    ("format", "Encoding of --file and --export (json, cbor, msgpack, ubjson), by default from the extension", cxxopts::value<std::string>())
+    ("m,mmap", "Memory map the history file instead of streaming it")
+    ("c,chunked", "Fetch a range as one request per month, this many at once", cxxopts::value<unsigned>())
+    ("store", "Local store of daily prices, only days missing from it are fetched", cxxopts::value<std::string>())
+    ("cache", "Directory to cache responses in, for repeated runs", cxxopts::value<std::string>())
+    ("cache-ttl", "Seconds before cached responses are revalidated", cxxopts::value<std::int64_t>()->default_value("3600"))
+    ("export", "Write the history to a file, encoded as for --format", cxxopts::value<std::string>())
+    ("export-bin", "Write the history to a binary file for fast loading", cxxopts::value<std::string>())
+    ("delta", "Delta encode timestamps in exported binary files")
+    ("serve", "Keep the history loaded and serve stats over HTTP on this port", cxxopts::value<int>())
+    ("bind", "Address to serve on", cxxopts::value<std::string>()->default_value("0.0.0.0"))
+    ("refresh", "Seconds between reloads of the history when serving, 0 for never", cxxopts::value<std::int64_t>()->default_value("300"))
+    ("query-cache", "Number of ranges to cache stats for when serving", cxxopts::value<std::size_t>()->default_value("1024"))
+    ("workers", "Threads handling connections when serving", cxxopts::value<std::size_t>()->default_value("16"))
+    ("queue", "Connections waiting for a worker before new ones are left unaccepted", cxxopts::value<std::size_t>()->default_value("128"))
+    ("compress", "Hold the history compressed when serving, for long histories in less memory")
+    ("t,threads", "Number of threads to analyze with, 0 for one per core", cxxopts::value<unsigned>()->default_value("1"))
     ("r,range", "Date range to analyze data for [FROM TO] (YYYY-MM-DD)", cxxopts::value<std::vector<std::string>>()) ;
 
     try
@@ -56,12 +108,148 @@ int main(int argc, const char *argv[])
             return 0;
         }
 
+        Profiler::setEnabled(result.count("profile") > 0);
+
+        OutputWriter::Format output;
+        if (!OutputWriter::parseFormat(result["output"].as<std::string>(), output))
+        {
+            std::cout << "Unknown output format " << result["output"].as<std::string>() << std::endl;
+            return 1;
+        }
+
+        // Messages all go to std::cout, which would spoil machine readable
+        // output, so send them to stderr and keep stdout for the data
+        auto text = output == OutputWriter::Format::Text;
+        std::ostream data(std::cout.rdbuf());
+        if (!text)
+        {
+            std::cout.rdbuf(std::cerr.rdbuf());
+        }
+
+        // Validate Dates
+        std::vector<std::string> dates;
+        std::int64_t from = 0, to = 0;
+        if (result.count("range"))
+        {
+            dates = result["range"].as<std::vector<std::string>>();
+            if (!parseRange(dates, from, to))
+            {
+                return 1;
+            }
+        }
+
+        // Explicit encoding for files, otherwise it comes from the extension
+        auto format = [&result](const std::string& path)
+        {
+            auto format = HistorySourceFile::formatFromPath(path);
+            if (result.count("format"))
+            {
+                HistorySourceFile::parseFormat(result["format"].as<std::string>(), format);
+            }
+            return format;
+        };
+
+        HistorySourceFile::Format fileFormat;
+        if (result.count("format") && !HistorySourceFile::parseFormat(result["format"].as<std::string>(), fileFormat))
+        {
+            std::cout << "Unknown format " << result["format"].as<std::string>() << std::endl;
+            return 1;
+        }
+
+        if (result.count("compress") && !result.count("serve"))
+        {
+            std::cout << "Please provide a port to serve on, history is only held compressed when serving" << std::endl;
+            return 1;
+        }
+
+        if (result.count("batch"))
+        {
+            // Patterns may be repeated or comma separated
+            std::vector<std::string> patterns;
+            for (auto& list : result["batch"].as<std::vector<std::string>>())
+            {
+                std::stringstream stream(list);
+                std::string pattern;
+                while (std::getline(stream, pattern, ','))
+                {
+                    if (!pattern.empty())
+                    {
+                        patterns.push_back(pattern);
+                    }
+                }
+            }
+
+            auto paths = BatchAnalyzer::expand(patterns);
+            if (paths.empty())
+            {
+                std::cout << "No history files to analyze" << std::endl;
+                return 1;
+            }
+
+            BatchAnalyzer batch(result["jobs"].as<unsigned>());
+            batch.setMode(result.count("mmap") ? HistorySourceFile::Mode::MemoryMap
+                                               : HistorySourceFile::Mode::Stream);
+            if (result.count("format"))
+            {
+                batch.setFormat(fileFormat);
+            }
+
+            if (!dates.empty())
+            {
+                batch.setRange(from, to);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            auto results = batch.run(paths);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            std::size_t failed = 0;
+            {
+                Profiler::Scope scope("output");
+
+                OutputWriter writer(data, output);
+                if (text)
+                {
+                    data << "Stats for " << results.size() << " files:" << std::endl;
+                }
+                for (auto& file : results)
+                {
+                    writer.file(file.path, file.ok ? &file.stats : nullptr);
+                    failed += !file.ok;
+                }
+                writer.finish();
+
+                std::cout << "Analyzed " << results.size() - failed << " of " << results.size()
+                    << " files in " << elapsed.count() << "s" << std::endl;
+            }
+
+            if (result.count("profile"))
+            {
+                std::cout << std::endl;
+                Profiler::report(std::cout);
+            }
+            return failed ? 1 : 0;
+        }
+
         // Determine which source to use
         std::unique_ptr<HistorySource> source;
+        std::unique_ptr<HTTPCache> cache;
+        if (result.count("cache"))
+        {
+            cache = std::make_unique<HTTPCache>(result["cache"].as<std::string>(),
+                result["cache-ttl"].as<std::int64_t>());
+        }
 
-        if (result.count("file"))
+        if (result.count("file") && HistorySourceBinary::isBinary(result["file"].as<std::string>()))
         {
-            source = std::make_unique<HistorySourceFile>(result["file"].as<std::string>());
+            source = std::make_unique<HistorySourceBinary>(result["file"].as<std::string>());
+        }
+        else if (result.count("file"))
+        {
+            auto mode = result.count("mmap") ? HistorySourceFile::Mode::MemoryMap
+                                             : HistorySourceFile::Mode::Stream;
+            auto& path = result["file"].as<std::string>();
+            source = std::make_unique<HistorySourceFile>(path, mode, format(path));
         }
         else
         {
@@ -69,18 +257,40 @@ int main(int argc, const char *argv[])
             auto host = "api.coindesk.com"s;
             auto query = "/v1/bpi/historical/close.json"s;
 
-            // Check for range date param
-            if (result.count("range"))
+            // Sources fetch whole days, the range having been checked already
+            std::int64_t firstDay = 0, lastDay = 0;
+            if (!dates.empty())
             {
-                // Validate Dates
-                auto& dates = result["range"].as<std::vector<std::string>>();
+                DateTime::parse(dates[0], firstDay);
+                DateTime::parse(dates[1], lastDay);
+            }
 
-                if (dates.size() !=2)
+            if (result.count("store"))
+            {
+                if (dates.empty())
                 {
-                    std::cout << "Please provide 2 dates for range, in the format \"YYYY-MM-DD YYYY-MM-DD\"" << std::endl;
+                    std::cout << "Please provide a range to read from the store" << std::endl;
                     return 1;
                 }
-
+                auto store = std::make_unique<HistorySourceStore>(result["store"].as<std::string>(),
+                    host, query, firstDay, lastDay);
+                store->setCache(cache.get());
+                source = std::move(store);
+            }
+            else if (result.count("chunked"))
+            {
+                if (dates.empty())
+                {
+                    std::cout << "Please provide a range to fetch in chunks" << std::endl;
+                    return 1;
+                }
+                auto chunked = std::make_unique<HistorySourceHTTPChunked>(host, query, firstDay, lastDay,
+                    result["chunked"].as<unsigned>());
+                chunked->setCache(cache.get());
+                source = std::move(chunked);
+            }
+            else if (!dates.empty())
+            {
                 // Set query params
                 query.append("?start=" + dates[0]);
                 query.append("&end=" + dates[1]);
@@ -90,46 +300,122 @@ int main(int argc, const char *argv[])
                 // No range provided, API will return previous 31 days by default
                 std::cout << "Using data from previous 31 days" << std::endl;
             }
-            source = std::make_unique<HistorySourceHTTP>(host, query);
-        }
 
-        auto data = source->get();
+            if (!source)
+            {
+                auto http = std::make_unique<HistorySourceHTTP>(host, query);
+                http->setCache(cache.get());
+                source = std::move(http);
+            }
+        }
 
-        if (!data)
+        if (result.count("serve"))
         {
-            std::cout << "Failed to get source data" << std::endl;
-            return 1;
+            StatsServer server(std::move(source), result["threads"].as<unsigned>(),
+                result["query-cache"].as<std::size_t>());
+            server.setRefreshInterval(result["refresh"].as<std::int64_t>());
+            server.setThreadPool(result["workers"].as<std::size_t>(), result["queue"].as<std::size_t>());
+            server.setCompressed(result.count("compress") > 0);
+            if (!server.load())
+            {
+                return 1;
+            }
+
+            auto& host = result["bind"].as<std::string>();
+            auto port = server.bind(host, result["serve"].as<int>());
+            if (port < 0)
+            {
+                std::cout << "Failed to serve on " << host << ":" << result["serve"].as<int>() << std::endl;
+                return 1;
+            }
+
+            std::cout << "Serving stats on " << host << ":" << port << std::endl;
+            return server.run() ? 0 : 1;
         }
 
         HistoryAnalyzer analyzer;
-        analyzer.parse(*data);
+        analyzer.setThreadCount(result["threads"].as<unsigned>());
 
-        // If verbose output, spit out the raw data
-        if (result.count("verbose"))
         {
-            auto& rawData = analyzer.getDataPoints();
-            for (auto& p : rawData)
+            Profiler::Scope scope("source");
+            if (!source->read(analyzer))
             {
-                std::cout << p.date << ": " << p.price << std::endl;
+                std::cout << "Failed to get source data" << std::endl;
+                return 1;
             }
         }
-        // Output stats
-        auto stats = analyzer.analyze();
-        std::cout << "Stats for data:" << std::endl
 
-        << "Total samples: " << stats.dataSize << std::endl
+        if (result.count("export") || result.count("export-bin"))
+        {
+            Profiler::Scope scope("export");
+
+            if (result.count("export") && !HistorySourceFile::write(result["export"].as<std::string>(),
+                analyzer, format(result["export"].as<std::string>())))
+            {
+                return 1;
+            }
 
-        << "Highest price was $" << stats.highest.price 
-        << " on " << stats.highest.date << std::endl
+            if (result.count("export-bin") && !HistorySourceBinary::write(result["export-bin"].as<std::string>(),
+                analyzer, result.count("delta") > 0))
+            {
+                return 1;
+            }
+        }
 
-        << "Lowest price was $" << stats.lowest.price
-        << " on " << stats.lowest.date << std::endl
+        // The file holds the full history, so only analyze the range
+        auto analyzeRange = result.count("file") && !dates.empty();
 
-        << "Mean price was $" << stats.meanPrice << std::endl
+        // Output stats
+        HistoryAnalyzer::Stats stats;
+        {
+            Profiler::Scope scope("analyze");
 
-        << "Median price was $" << stats.medianPrice << std::endl
+            if (analyzeRange)
+            {
+                auto rangeStats = analyzer.analyze(from, to);
+                if (!rangeStats)
+                {
+                    std::cout << "No data found in range" << std::endl;
+                    return 1;
+                }
+                stats = *rangeStats;
+            }
+            else
+            {
+                stats = analyzer.analyze();
+            }
+        }
+
+        // Only write once everything's analyzed, so no message lands in
+        // the middle of buffered output
+        {
+            Profiler::Scope scope("output");
+
+            OutputWriter writer(data, output);
+            // If verbose output, spit out the raw data that was analyzed
+            if (result.count("verbose"))
+            {
+                auto& times = analyzer.getTimes();
+                std::size_t begin = 0, end = analyzer.size();
+                if (analyzeRange)
+                {
+                    begin = std::lower_bound(times.begin(), times.end(), from) - times.begin();
+                    end = std::upper_bound(times.begin(), times.end(), to) - times.begin();
+                }
+                for (auto i = begin; i < end; ++i)
+                {
+                    writer.point(analyzer.getDataPoint(i));
+                }
+            }
+            writer.stats(stats);
+            writer.finish();
+        }
 
-        << "Standard deviation of $" << stats.standardDeviation << std::endl;
+        if (result.count("profile"))
+        {
+            std::cout << std::endl;
+            Profiler::report(std::cout);
+        }
     }
     catch(cxxopts::OptionException& e)
     {
@@ -25,11 +25,44 @@
 #define CATCH_CONFIG_MAIN
 #include <catch/catch-2.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
 #include <json/json.hpp>
 
+#include "BatchAnalyzer.hpp"
+#include "CompressedSeries.hpp"
+#include "DateTime.hpp"
+#include "HTTPCache.hpp"
+#include "HTTPConnectionPool.hpp"
 #include "HistoryAnalyzer.hpp"
+#include "HistoryIndex.hpp"
+#include "HistorySourceBinary.hpp"
 #include "HistorySourceFile.hpp"
 #include "HistorySourceHTTP.hpp"
+#include "HistorySourceHTTPChunked.hpp"
+#include "HistorySourceStore.hpp"
+#include "HistoryStore.hpp"
+#include "MockHistoryServer.hpp"
+#include "OutputWriter.hpp"
+#include "Profiler.hpp"
+#include "Reduction.hpp"
+#include "Selection.hpp"
+#include "StatsAccumulator.hpp"
+#include "StatsCache.hpp"
+#include "StatsServer.hpp"
 
 namespace
 {
@@ -67,6 +100,18 @@ namespace
             {"updatedISO", "2018-01-21T00:03:00+00:00"}
         }}
     };
+
+    // Run a server on its own thread, returning once it's accepting
+    // connections, as stopping it any earlier has no effect
+    std::thread startServer(httplib::Server& server)
+    {
+        std::thread thread([&server] { server.listen_after_bind(); });
+        while (!server.is_running())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return thread;
+    }
 }
 
 // HistoryAnalyzer tests
@@ -78,11 +123,11 @@ TEST_CASE("History json is analyzed correctly")
     
     SECTION("Data points populate correctly")
     {
-        auto dataPoints = analyzer.getDataPoints();
-
-        for (auto& p : dataPoints)
+        REQUIRE(analyzer.size() == exampleJson["bpi"].size());
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
         {
-            REQUIRE(exampleJson["bpi"][p.date] == p.price);
+            auto p = analyzer.getDataPoint(i);
+            REQUIRE(exampleJson["bpi"][DateTime::format(p.time)] == p.price);
         }
     }
 
@@ -90,11 +135,88 @@ TEST_CASE("History json is analyzed correctly")
     {
         auto stats = analyzer.analyze();
         REQUIRE(stats.dataSize == 20);
-        REQUIRE(stats.highest.date ==  "2018-01-06");
+        REQUIRE(DateTime::format(stats.highest.time) ==  "2018-01-06");
         REQUIRE(stats.highest.price == 17135.8363);
-        REQUIRE(stats.lowest.date ==  "2018-01-17");
+        REQUIRE(DateTime::format(stats.lowest.time) ==  "2018-01-17");
         REQUIRE(stats.lowest.price == 11141.2488);
         REQUIRE(stats.meanPrice == Approx(13975.165275));
+        REQUIRE(stats.medianPrice == Approx(14000.75));
+        REQUIRE(stats.standardDeviation == Approx(1777.2217146829894));
+    }
+
+    SECTION("Parallel analysis matches sequential analysis")
+    {
+        // Enough points to actually split over threads
+        HistoryAnalyzer large;
+        nlohmann::json json;
+        for (int i = 0; i < 300000; ++i)
+        {
+            auto date = DateTime::format(1514764800 + i * 60);
+            json["bpi"][date] = 10000. + (i * 7919LL) % 10007;
+        }
+        REQUIRE(large.parse(json));
+
+        HistoryAnalyzer parallel;
+        REQUIRE(parallel.parse(json));
+        parallel.setThreadCount(4);
+
+        auto expected = large.analyze();
+        auto stats = parallel.analyze();
+
+        REQUIRE(stats.dataSize == expected.dataSize);
+        REQUIRE(stats.highest.time == expected.highest.time);
+        REQUIRE(stats.lowest.time == expected.lowest.time);
+        REQUIRE(stats.meanPrice == Approx(expected.meanPrice));
+        REQUIRE(stats.medianPrice == expected.medianPrice);
+        REQUIRE(stats.standardDeviation == Approx(expected.standardDeviation));
+    }
+
+    SECTION("Appending keeps stats up to date")
+    {
+        // Append the example data in halves, analyzing part way through
+        HistoryAnalyzer incremental;
+        auto& bpi = exampleJson["bpi"];
+        std::size_t count = 0;
+        for (auto it = bpi.begin(); it != bpi.end(); ++it, ++count)
+        {
+            REQUIRE(incremental.append(it.key(), it.value().get<double>()));
+            if (count == 9)
+            {
+                REQUIRE(incremental.analyze().dataSize == 10);
+            }
+        }
+
+        auto expected = analyzer.analyze();
+        auto stats = incremental.analyze();
+        REQUIRE(stats.dataSize == expected.dataSize);
+        REQUIRE(stats.highest.time == expected.highest.time);
+        REQUIRE(stats.lowest.time == expected.lowest.time);
+        REQUIRE(stats.meanPrice == Approx(expected.meanPrice));
+        REQUIRE(stats.medianPrice == expected.medianPrice);
+        REQUIRE(stats.standardDeviation == Approx(expected.standardDeviation));
+
+        // Each further append moves the median
+        REQUIRE(incremental.append("2018-01-21", 20000.));
+        REQUIRE(incremental.analyze().medianPrice == 14188.785);
+        REQUIRE(incremental.analyze().highest.price == 20000.);
+        REQUIRE(incremental.append("2018-01-22", 1.));
+        REQUIRE(incremental.analyze().medianPrice == Approx(14000.75));
+        REQUIRE(incremental.analyze().lowest.price == 1.);
+
+        // Out of order, repeated and invalid data points are refused
+        REQUIRE_FALSE(incremental.append("2018-01-01", 1.));
+        REQUIRE_FALSE(incremental.append("2018-01-22", 2.));
+        REQUIRE_FALSE(incremental.append("boop", 1.));
+        REQUIRE(incremental.size() == 22);
+        REQUIRE(incremental.analyze().dataSize == 22);
+        REQUIRE(incremental.getDataPoint(21).price == 1.);
+    }
+
+    SECTION("Data points keep chronological order")
+    {
+        auto& times = analyzer.getTimes();
+        REQUIRE(std::is_sorted(times.begin(), times.end()));
+        REQUIRE(DateTime::format(times.front()) == "2018-01-01");
     }
 
     SECTION("Improper json is handled properly")
@@ -107,61 +229,1898 @@ TEST_CASE("History json is analyzed correctly")
 
         json = {"beep", 12};
         REQUIRE(!analyzer.parse(json));
+
+        json = {{"bpi", {{"boop", 12}}}};
+        REQUIRE(!analyzer.parse(json));
     }
 }
 
-// HistorySourceHTTP tests
-TEST_CASE("Get history from http request")
-{   
-    SECTION("HTTP request succeeds with valid URI")
+// HistoryIndex tests
+TEST_CASE("Date ranges are queried from an index")
+{
+    HistoryAnalyzer analyzer;
+    REQUIRE(analyzer.parse(exampleJson));
+    HistoryIndex index(analyzer);
+
+    SECTION("Whole range matches analysis")
     {
-        HistorySourceHTTP source("api.coindesk.com",
-            "/v1/bpi/historical/close.json?start=2018-01-01&end=2018-01-20");
+        std::int64_t from, to;
+        REQUIRE(DateTime::parse("2018-01-01", from));
+        REQUIRE(DateTime::parse("2018-01-20", to));
 
-        auto data = source.get();
-        REQUIRE(static_cast<bool>(data));
-        REQUIRE(*data == exampleJson);
+        auto expected = analyzer.analyze();
+        auto stats = index.query(from, to);
+        REQUIRE(stats);
+        REQUIRE(stats->dataSize == expected.dataSize);
+        REQUIRE(stats->highest.time == expected.highest.time);
+        REQUIRE(stats->lowest.time == expected.lowest.time);
+        REQUIRE(stats->meanPrice == Approx(expected.meanPrice));
+        REQUIRE(stats->medianPrice == expected.medianPrice);
+        REQUIRE(stats->standardDeviation == Approx(expected.standardDeviation));
     }
 
-    SECTION("HTTP request fails with invalid URI")
+    SECTION("Every sub range matches analysing it alone")
     {
-        HistorySourceHTTP source("http://beep.boop", "queery");
-        REQUIRE_FALSE(static_cast<bool>(source.get()));
+        // Enough points to span several sparse table blocks, with repeats
+        HistoryAnalyzer large;
+        for (std::int64_t i = 0; i < 1000; ++i)
+        {
+            REQUIRE(large.append(1514764800 + i * 60, 10000. + (i * 7919) % 101));
+        }
+        HistoryIndex largeIndex(large);
 
-        HistorySourceHTTP source2("apo.beep.boop", "queery");
-        REQUIRE_FALSE(static_cast<bool>(source2.get()));
+        for (std::size_t begin = 0; begin < 1000; begin += 37)
+        {
+            for (std::size_t end = begin + 1; end <= 1000; end += 29)
+            {
+                HistoryAnalyzer part;
+                for (auto i = begin; i < end; ++i)
+                {
+                    auto p = large.getDataPoint(i);
+                    part.append(p.time, p.price);
+                }
+                auto expected = part.analyze();
+                auto stats = largeIndex.queryPositions(begin, end);
+
+                REQUIRE(stats.dataSize == expected.dataSize);
+                REQUIRE(stats.highest.time == expected.highest.time);
+                REQUIRE(stats.lowest.time == expected.lowest.time);
+                REQUIRE(stats.meanPrice == Approx(expected.meanPrice));
+                REQUIRE(stats.medianPrice == expected.medianPrice);
+                REQUIRE(stats.standardDeviation == Approx(expected.standardDeviation).margin(1e-9));
+
+                // Filtering the range without an index agrees too
+                auto filtered = large.analyze(large.getDataPoint(begin).time, large.getDataPoint(end - 1).time);
+                REQUIRE(filtered);
+                REQUIRE(filtered->dataSize == expected.dataSize);
+                REQUIRE(filtered->highest.time == expected.highest.time);
+                REQUIRE(filtered->lowest.time == expected.lowest.time);
+                REQUIRE(filtered->meanPrice == Approx(expected.meanPrice));
+                REQUIRE(filtered->medianPrice == expected.medianPrice);
+
+                // Every order statistic, against sorting the range
+                auto& prices = large.getPrices();
+                std::vector<double> sorted(prices.begin() + begin, prices.begin() + end);
+                std::sort(sorted.begin(), sorted.end());
+                for (std::size_t k = 0; k < sorted.size(); k += 7)
+                {
+                    REQUIRE(largeIndex.kthSmallest(begin, end, k) == sorted[k]);
+                }
+            }
+        }
+    }
+
+    SECTION("Short ranges of a long, high priced series stay accurate")
+    {
+        // A long cheap stretch, then a jump to prices far larger than their
+        // spread, so the stretch before dwarfs any short range after it
+        HistoryAnalyzer large;
+        const std::int64_t count = 1 << 20;
+        for (std::int64_t i = 0; i < count; ++i)
+        {
+            auto price = i < count / 2 ? 1000. + (i * 7919) % 101 : 1e9 + ((i * 7919) % 101) * 0.01;
+            REQUIRE(large.append(1514764800 + i * 60, price));
+        }
+        HistoryIndex largeIndex(large);
+
+        for (auto range : {std::make_pair(count / 2 + 5, count / 2 + 20), std::make_pair(count - 1000, count - 900),
+            std::make_pair(count / 2 - 10, count / 2 + 10), std::make_pair(count * 3 / 4 + 3, count * 3 / 4 + 70)})
+        {
+            auto from = large.getDataPoint(range.first).time;
+            auto to = large.getDataPoint(range.second).time;
+            auto stats = largeIndex.query(from, to);
+            auto expected = large.analyze(from, to);
+            REQUIRE(static_cast<bool>(stats));
+            REQUIRE(static_cast<bool>(expected));
+            REQUIRE(stats->dataSize == expected->dataSize);
+            REQUIRE(stats->meanPrice == Approx(expected->meanPrice));
+            REQUIRE(stats->standardDeviation == Approx(expected->standardDeviation));
+        }
+    }
+
+    SECTION("Quantiles interpolate between closest ranks")
+    {
+        std::int64_t from, to;
+        REQUIRE(DateTime::parse("2018-01-01", from));
+        REQUIRE(DateTime::parse("2018-01-04", to));
+
+        // 13412.44, 14740.7563, 15134.6513, 15155.2263
+        REQUIRE(*index.quantile(from, to, 0.) == 13412.44);
+        REQUIRE(*index.quantile(from, to, 1.) == 15155.2263);
+        REQUIRE(*index.quantile(from, to, 0.5) == Approx(14937.7038));
+        REQUIRE(*index.quantile(from, to, 1. / 3) == Approx(14740.7563));
+        REQUIRE(*index.quantile(from, to, 0.25) == Approx(14408.67720));
+        REQUIRE(index.query(from, to)->medianPrice == Approx(14937.7038));
+
+        REQUIRE(DateTime::parse("2019-01-01", from));
+        REQUIRE_FALSE(index.quantile(from, to, 0.5));
+    }
+
+    SECTION("Ranges without data return nothing")
+    {
+        std::int64_t from, to;
+        REQUIRE(DateTime::parse("2019-01-01", from));
+        REQUIRE(DateTime::parse("2019-02-01", to));
+        REQUIRE_FALSE(index.query(from, to));
+        REQUIRE_FALSE(index.query(to, from));
+        REQUIRE_FALSE(analyzer.analyze(from, to));
     }
 }
 
-// HistorySourceFile tests
-TEST_CASE("Get history from file")
-{   
-    // Dump the example json into a file for test purposes
-    const std::string testFilePath("test.json");
-    std::ofstream testFile(testFilePath, std::ios::trunc);
-    testFile << exampleJson;
-    testFile.close();
+// Reduction tests
+TEST_CASE("Reduction kernels agree")
+{
+    // Prices with repeats, so ties for min and max have to resolve the same way
+    std::vector<double> prices;
+    for (int i = 0; i < 1003; ++i)
+    {
+        prices.push_back(10000. + (i * 7919) % 101);
+    }
 
-    SECTION("Valid file loads correctly")
+    auto expectedMin = std::min_element(prices.begin(), prices.end()) - prices.begin();
+    auto expectedMax = std::max_element(prices.begin(), prices.end()) - prices.begin();
+
+    for (auto kernel : {Reduction::Kernel::Scalar, Reduction::Kernel::SSE2, Reduction::Kernel::AVX2})
     {
-        HistorySourceFile source(testFilePath);
+        if (!Reduction::isSupported(kernel))
+        {
+            continue;
+        }
+
+        // Odd lengths exercise the scalar tails
+        for (std::size_t count : {std::size_t(1), std::size_t(3), prices.size()})
+        {
+            auto result = Reduction::run(prices.data(), count, prices[0], kernel);
+            auto begin = prices.begin();
+            auto end = prices.begin() + count;
+
+            REQUIRE(result.argMin == static_cast<std::size_t>(std::min_element(begin, end) - begin));
+            REQUIRE(result.argMax == static_cast<std::size_t>(std::max_element(begin, end) - begin));
+            REQUIRE(result.min == prices[result.argMin]);
+            REQUIRE(result.max == prices[result.argMax]);
+
+            double sum = 0., sumSquares = 0.;
+            for (auto it = begin; it != end; ++it)
+            {
+                sum += *it - prices[0];
+                sumSquares += (*it - prices[0]) * (*it - prices[0]);
+            }
+            REQUIRE(result.sum == Approx(sum));
+            REQUIRE(result.sumSquares == Approx(sumSquares));
+        }
+
+        auto result = Reduction::run(prices.data(), prices.size(), prices[0], kernel);
+        REQUIRE(result.argMin == static_cast<std::size_t>(expectedMin));
+        REQUIRE(result.argMax == static_cast<std::size_t>(expectedMax));
+    }
+}
+
+// Profiler tests
+TEST_CASE("Phases are profiled only while enabled")
+{
+    Profiler::reset();
+    {
+        Profiler::Scope scope("disabled");
+        std::vector<double> values(1000);
+    }
+    REQUIRE(Profiler::phases().empty());
+
+    // Linking the library alone leaves the allocator alone, so count
+    // allocations by hand as the replacement allocator would
+    REQUIRE_FALSE(Profiler::countsAllocations());
+
+    Profiler::setEnabled(true);
+    for (int i = 0; i < 2; ++i)
+    {
+        Profiler::Scope outer("outer");
+        Profiler::countAllocation(1000 * sizeof(double));
+        {
+            Profiler::Scope inner("inner");
+            Profiler::countAllocation(1 << 20);
+            HistoryAnalyzer analyzer;
+            REQUIRE(analyzer.parse(exampleJson));
+
+            // Scopes on other threads are kept apart from this thread's
+            std::thread worker([] { Profiler::Scope scope("outer"); });
+            worker.join();
+        }
+    }
+    Profiler::setEnabled(false);
+
+    auto phases = Profiler::phases();
+    REQUIRE(phases.size() == 4);
+    REQUIRE(phases[0].name == "outer");
+    REQUIRE(phases[0].depth == 0);
+    REQUIRE(phases[0].calls == 2);
+    REQUIRE(phases[1].name == "inner");
+    REQUIRE(phases[1].depth == 1);
+    REQUIRE(phases[2].name == "parse");
+    REQUIRE(phases[2].depth == 2);
+    REQUIRE_FALSE(phases[0].worker);
+    REQUIRE(phases[3].name == "outer");
+    REQUIRE(phases[3].worker);
+    REQUIRE(phases[3].depth == 0);
+    REQUIRE(phases[3].calls == 2);
+
+    // Outer phases include what's nested in them
+    REQUIRE(phases[1].bytesAllocated == 2 * (1 << 20));
+    REQUIRE(phases[0].bytesAllocated == phases[1].bytesAllocated + 2 * 1000 * sizeof(double));
+    REQUIRE(phases[0].wallSeconds >= phases[1].wallSeconds);
+    REQUIRE(phases[0].peakResidentBytes > 0);
+
+    std::ostringstream report;
+    Profiler::report(report);
+    REQUIRE(report.str().find("    parse") != std::string::npos);
+    REQUIRE(report.str().find("On worker threads") != std::string::npos);
+    Profiler::reset();
+}
+
+// Selection tests
+TEST_CASE("Medians are selected without sorting")
+{
+    std::vector<double> values = {5., 1., 4., 2., 3.};
+    REQUIRE(Selection::median(values.data(), values.size()) == 3.);
+
+    values = {5., 1., 4., 2., 3., 6.};
+    REQUIRE(Selection::median(values.data(), values.size()) == 3.5);
+
+    values = {7.};
+    REQUIRE(Selection::median(values.data(), values.size()) == 7.);
+
+    values = {2., 2., 1., 2.};
+    REQUIRE(Selection::median(values.data(), values.size()) == 2.);
+    REQUIRE(Selection::kthSmallest(values.data(), values.size(), 0) == 1.);
+}
+
+TEST_CASE("Parallel selection matches sequential selection")
+{
+    std::vector<double> values;
+    for (int i = 0; i < 300001; ++i)
+    {
+        values.push_back(((i * 7919LL) % 10007) * 0.5 - 1000.);
+    }
+
+    for (std::size_t count : {std::size_t(1), std::size_t(2), std::size_t(1000), values.size() - 1, values.size()})
+    {
+        std::vector<double> copy(values.begin(), values.begin() + count);
+        auto expected = Selection::median(copy.data(), copy.size());
+
+        for (unsigned threads : {1u, 4u})
+        {
+            REQUIRE(Selection::parallelMedian(values.data(), count, threads) == expected);
+        }
+    }
+
+    std::vector<double> copy(values);
+    auto expected = Selection::kthSmallest(copy.data(), copy.size(), 12345);
+    REQUIRE(Selection::parallelKthSmallest(values.data(), values.size(), 12345, 3) == expected);
+}
+
+TEST_CASE("Streaming selection visits values a block at a time")
+{
+    std::vector<double> values;
+    for (int i = 0; i < 5000; ++i)
+    {
+        values.push_back(((i * 7919LL) % 10007) * 0.25 - 500.);
+    }
+    values.push_back(-0.);
+    values.push_back(0.);
+
+    auto visits = 0;
+    auto blocks = [&values, &visits](const std::function<void(const double*, std::size_t)>& visit)
+    {
+        ++visits;
+        for (std::size_t i = 0; i < values.size(); i += 999)
+        {
+            visit(values.data() + i, std::min<std::size_t>(999, values.size() - i));
+        }
+    };
+
+    std::vector<double> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t k : {std::size_t(0), std::size_t(1), std::size_t(2500), values.size() - 1})
+    {
+        REQUIRE(Selection::streamingKthSmallest(blocks, k) == sorted[k]);
+    }
+
+    std::vector<double> copy(values);
+    visits = 0;
+    REQUIRE(Selection::streamingMedian(blocks, values.size()) == Selection::median(copy.data(), copy.size()));
+    REQUIRE(visits <= 5);
+}
+
+// StatsAccumulator tests
+TEST_CASE("Statistics accumulate in one pass")
+{
+    // Large offset with a small spread, where naive sums lose precision
+    std::vector<double> values;
+    for (int i = 0; i < 10000; ++i)
+    {
+        values.push_back(1e9 + (i % 7) * 0.25);
+    }
+
+    // Two pass reference
+    double mean = 0.;
+    for (auto v : values)
+    {
+        mean += (v - 1e9);
+    }
+    mean = 1e9 + mean / values.size();
+    double m2 = 0.;
+    for (auto v : values)
+    {
+        m2 += (v - mean) * (v - mean);
+    }
+    auto variance = m2 / (values.size() - 1);
+
+    SECTION("Single values and blocks agree with two pass results")
+    {
+        StatsAccumulator single;
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            single.add(values[i], i);
+        }
+
+        StatsAccumulator block;
+        block.add(values.data(), values.size(), 0);
+
+        for (auto& accumulator : {single, block})
+        {
+            REQUIRE(accumulator.count() == values.size());
+            REQUIRE(accumulator.mean() == Approx(mean).epsilon(1e-15));
+            REQUIRE(accumulator.variance() == Approx(variance).epsilon(1e-9));
+            REQUIRE(accumulator.min() == 1e9);
+            REQUIRE(accumulator.argMin() == 0);
+            REQUIRE(accumulator.max() == 1e9 + 1.5);
+            REQUIRE(accumulator.argMax() == 6);
+        }
+    }
+
+    SECTION("Merged partial states match a single state")
+    {
+        StatsAccumulator merged;
+        for (std::size_t offset = 0; offset < values.size(); offset += 999)
+        {
+            StatsAccumulator partial;
+            auto count = std::min<std::size_t>(999, values.size() - offset);
+            partial.add(values.data() + offset, count, offset);
+            merged.merge(partial);
+        }
+
+        REQUIRE(merged.count() == values.size());
+        REQUIRE(merged.mean() == Approx(mean).epsilon(1e-15));
+        REQUIRE(merged.variance() == Approx(variance).epsilon(1e-9));
+        REQUIRE(merged.argMin() == 0);
+        REQUIRE(merged.argMax() == 6);
+    }
+
+    SECTION("Empty and single value states are handled")
+    {
+        StatsAccumulator accumulator;
+        REQUIRE(accumulator.count() == 0);
+        REQUIRE(accumulator.variance() == 0.);
+
+        accumulator.merge(StatsAccumulator());
+        REQUIRE(accumulator.count() == 0);
+
+        accumulator.add(5., 3);
+        REQUIRE(accumulator.mean() == 5.);
+        REQUIRE(accumulator.variance() == 0.);
+        REQUIRE(accumulator.argMin() == 3);
+    }
+}
+
+// DateTime tests
+TEST_CASE("Dates convert to and from timestamps")
+{
+    std::int64_t time;
+
+    SECTION("Valid dates parse and format back")
+    {
+        for (std::string date : {"1970-01-01", "2018-01-06", "2000-02-29", "2018-01-06 13:45",
+            "2018-01-06 13:45:12", "1969-12-31 23:59:59"})
+        {
+            REQUIRE(DateTime::parse(date, time));
+            REQUIRE(DateTime::format(time) == date);
+        }
+
+        REQUIRE(DateTime::parse("1970-01-02", time));
+        REQUIRE(time == DateTime::SecondsPerDay);
+
+        REQUIRE(DateTime::parse("2018-01-06T13:45", time));
+        REQUIRE(DateTime::format(time) == "2018-01-06 13:45");
+    }
+
+    SECTION("Years outside four digits format in full")
+    {
+        REQUIRE(DateTime::parse("0000-01-01", time));
+        REQUIRE(DateTime::format(time) == "0000-01-01");
+        REQUIRE(DateTime::format(time - 1) == "-0001-12-31 23:59:59");
+        REQUIRE(DateTime::parse("9999-12-31 23:59:59", time));
+        REQUIRE(DateTime::format(time) == "9999-12-31 23:59:59");
+        REQUIRE(DateTime::format(time + 1) == "10000-01-01");
+        REQUIRE(DateTime::format(DateTime::daysFromCivil(-12345, 6, 7) * DateTime::SecondsPerDay) == "-12345-06-07");
+
+        // The furthest timestamps either way fit in MaxLength
+        auto latest = DateTime::format(std::numeric_limits<std::int64_t>::max());
+        auto earliest = DateTime::format(std::numeric_limits<std::int64_t>::min());
+        REQUIRE(latest == "292277026596-12-04 15:30:07");
+        REQUIRE(earliest == "-292277022657-01-27 08:29:52");
+        REQUIRE(earliest.size() <= DateTime::MaxLength);
+
+        // and parse back to the same time
+        for (std::int64_t expected : {std::int64_t(-1), std::int64_t(253402300800), std::int64_t(-62167305600),
+            DateTime::daysFromCivil(-12345, 6, 7) * DateTime::SecondsPerDay + 3600,
+            std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min()})
+        {
+            auto text = DateTime::format(expected);
+            REQUIRE(DateTime::parse(text, time));
+            REQUIRE(time == expected);
+        }
+        REQUIRE(DateTime::parse("-0001-12-31 23:59:59", time));
+        REQUIRE(time == DateTime::daysFromCivil(0, 1, 1) * DateTime::SecondsPerDay - 1);
+        REQUIRE(DateTime::parse("-0004-02-29", time));
+
+        // Plain dates end a range at the end of the day, as far as that goes
+        REQUIRE(DateTime::parseEnd("10000-01-01", time));
+        REQUIRE(DateTime::format(time) == "10000-01-01 23:59:59");
+        REQUIRE(DateTime::parseEnd("10000-01-01 12:00", time));
+        REQUIRE(DateTime::format(time) == "10000-01-01 12:00");
+        REQUIRE(DateTime::parseEnd(latest.substr(0, 18), time));
+        REQUIRE(time == std::numeric_limits<std::int64_t>::max());
+
+        // Past the furthest timestamps
+        for (std::string date : {"292277026596-12-04 15:30:08", "292277026597-01-01", "-292277022657-01-27 08:29:51",
+            "999999999999-01-01", "1000000000000-01-01", "-999-01-01", "-2018-02-29", "10000-1-01"})
+        {
+            REQUIRE_FALSE(DateTime::parse(date, time));
+        }
+    }
+
+    SECTION("Invalid dates are rejected")
+    {
+        for (std::string date : {"", "boop", "2018-1-06", "2018-02-29", "2018-00-01",
+            "2018-01-32", "2018-01-06 24:00", "2018-01-06 12:60", "2018-01-06 12:00:", "2018/01/06"})
+        {
+            REQUIRE_FALSE(DateTime::parse(date, time));
+        }
+    }
+}
+
+// Streaming parser tests
+TEST_CASE("History json text is parsed without a json document")
+{
+    HistoryAnalyzer expected;
+    REQUIRE(expected.parse(exampleJson));
+
+    auto text = exampleJson.dump(4);
+
+    SECTION("Parsing from memory matches parsing the document")
+    {
+        HistoryAnalyzer analyzer;
+        REQUIRE(analyzer.parse(text.data(), text.size()));
+
+        REQUIRE(analyzer.size() == expected.size());
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
+        {
+            auto p = analyzer.getDataPoint(i);
+            REQUIRE(exampleJson["bpi"][DateTime::format(p.time)] == p.price);
+        }
+    }
+
+    SECTION("Parsing from a stream matches parsing the document")
+    {
+        std::istringstream stream(text);
+        HistoryAnalyzer analyzer;
+        REQUIRE(analyzer.parse(stream));
+
+        auto stats = analyzer.analyze();
+        auto expectedStats = expected.analyze();
+        REQUIRE(stats.dataSize == expectedStats.dataSize);
+        REQUIRE(stats.highest.time == expectedStats.highest.time);
+        REQUIRE(stats.lowest.time == expectedStats.lowest.time);
+        REQUIRE(stats.meanPrice == Approx(expectedStats.meanPrice));
+    }
+
+    SECTION("Escapes and skipped values are handled")
+    {
+        std::string json = R"({"a":[1,{"b":null},true,"\"\u00e9"],"bpi":{"2018\u002d01\u002d01":1.5e1}})";
+        HistoryAnalyzer analyzer;
+        REQUIRE(analyzer.parse(json.data(), json.size()));
+        REQUIRE(analyzer.size() == 1);
+        REQUIRE(DateTime::format(analyzer.getDataPoint(0).time) == "2018-01-01");
+        REQUIRE(analyzer.getDataPoint(0).price == 15.);
+    }
+
+    SECTION("Improper json text is handled properly")
+    {
+        HistoryAnalyzer analyzer;
+        for (std::string json : {"", "boop", "\"boop\"", "[\"beep\", 12]", "{}",
+            "{\"bpi\":[]}", "{\"bpi\":{\"2018-01-01\":\"beep\"}}",
+            "{\"bpi\":{\"2018-01-01\":1}", "{\"bpi\":{}} boop",
+            "{\"bpi\":{\"2018-13-01\":1}}"})
+        {
+            REQUIRE_FALSE(analyzer.parse(json.data(), json.size()));
+        }
+    }
+
+    SECTION("Only json numbers are read as prices")
+    {
+        HistoryAnalyzer analyzer;
+        for (std::string number : {"0", "-0", "15", "-1.5", "0.25", "1e3", "1E+3", "25e-1", "-0.5e1"})
+        {
+            auto json = "{\"bpi\":{\"2018-01-01\":" + number + "}}";
+            REQUIRE(analyzer.parse(json.data(), json.size()));
+            REQUIRE(analyzer.getDataPoint(0).price == std::stod(number));
+        }
+
+        for (std::string number : {"+1", "01", "-01", ".5", "5.", "-", "1e", "1e+", "1.e3", "--1",
+            "0x10", "1-2", "1e400"})
+        {
+            auto json = "{\"bpi\":{\"2018-01-01\":" + number + "}}";
+            REQUIRE_FALSE(analyzer.parse(json.data(), json.size()));
+
+            std::istringstream stream(json);
+            REQUIRE_FALSE(analyzer.parse(stream));
+        }
+    }
+}
+
+// HistorySourceHTTP tests
+TEST_CASE("Get history from http request")
+{
+    std::int64_t from, to;
+    REQUIRE(DateTime::parse("2018-01-01", from));
+    REQUIRE(DateTime::parse("2018-01-20", to));
+
+    // Check a response has every day of the range at the mock's prices
+    auto requireRange = [from, to](const nlohmann::json& json)
+    {
+        REQUIRE(json["bpi"].size() == 20);
+        for (auto time = from; time <= to; time += DateTime::SecondsPerDay)
+        {
+            REQUIRE(json["bpi"][DateTime::format(time)].get<double>() == MockHistoryServer::price(time, 42));
+        }
+    };
+
+    HTTPConnectionPool pool;
+    MockHistoryServer::Options options;
+
+    SECTION("HTTP request succeeds with valid URI")
+    {
+        MockHistoryServer server(options);
+        auto port = server.start();
+        REQUIRE(port > 0);
+
+        HistorySourceHTTP source("127.0.0.1", MockHistoryServer::query(from, to), port, pool);
         auto data = source.get();
         REQUIRE(static_cast<bool>(data));
-        REQUIRE(*data == exampleJson);
+        requireRange(*data);
+        REQUIRE(*data == nlohmann::json::parse(server.history(from, to)));
+
+        HistoryAnalyzer analyzer;
+        REQUIRE(source.read(analyzer));
+        REQUIRE(analyzer.size() == 20);
+        REQUIRE(analyzer.getDataPoint(19).price == MockHistoryServer::price(to, 42));
+
+        // Without a range, the configured number of points
+        HistorySourceHTTP all("127.0.0.1", MockHistoryServer::Path, port, pool);
+        REQUIRE(all.read(analyzer));
+        REQUIRE(analyzer.size() == options.points);
+        REQUIRE(server.requests() == 3);
+
+        HistorySourceHTTP invalid("127.0.0.1", MockHistoryServer::Path + "?start=2018-01-20&end=2018-01-01", port, pool);
+        REQUIRE_FALSE(static_cast<bool>(invalid.get()));
     }
 
-    SECTION("Invalid file fails cleanly")
+    SECTION("Chunked responses are reassembled")
     {
-        HistorySourceFile source("boop");
-        REQUIRE_FALSE(static_cast<bool>(source.get()));
+        options.chunkSize = 37;
+        MockHistoryServer server(options);
+        auto port = server.start();
+        REQUIRE(port > 0);
+
+        HistorySourceHTTP source("127.0.0.1", MockHistoryServer::query(from, to), port, pool);
+        for (int i = 0; i < 2; ++i)
+        {
+            auto data = source.get();
+            REQUIRE(static_cast<bool>(data));
+            requireRange(*data);
+        }
+        REQUIRE(pool.connectionsOpened() == 1);
     }
-    SECTION("Invalid json fails cleanly")
+
+    SECTION("Injected failures fail the request")
     {
-        testFile.open(testFilePath);
-        testFile << "boop";
-        testFile.close();
+        options.failEvery = 2;
+        MockHistoryServer server(options);
+        auto port = server.start();
+        REQUIRE(port > 0);
 
-        HistorySourceFile source(testFilePath);
+        HistorySourceHTTP source("127.0.0.1", MockHistoryServer::query(from, to), port, pool);
+        HistoryAnalyzer analyzer;
+        REQUIRE(source.read(analyzer));
+        REQUIRE_FALSE(source.read(analyzer));
+        REQUIRE(static_cast<bool>(source.get()));
         REQUIRE_FALSE(static_cast<bool>(source.get()));
+        REQUIRE(server.failures() == 2);
+
+        // Truncated json fails to parse rather than giving partial history
+        MockHistoryServer::Options truncated;
+        truncated.failEvery = 1;
+        truncated.failure = MockHistoryServer::Failure::Truncated;
+        MockHistoryServer broken(truncated);
+        port = broken.start();
+        REQUIRE(port > 0);
+
+        HistorySourceHTTP partial("127.0.0.1", MockHistoryServer::query(from, to), port, pool);
+        REQUIRE_FALSE(partial.read(analyzer));
+        REQUIRE_FALSE(static_cast<bool>(partial.get()));
+    }
+
+    SECTION("Slow responses are fetched concurrently")
+    {
+        options.latency = std::chrono::milliseconds(50);
+        MockHistoryServer server(options);
+        auto port = server.start();
+        REQUIRE(port > 0);
+
+        std::vector<std::thread> threads;
+        std::vector<int> ok(4);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < ok.size(); ++t)
+        {
+            threads.emplace_back([&pool, &ok, &from, &to, port, t]
+            {
+                HistoryAnalyzer analyzer;
+                ok[t] = HistorySourceHTTP("127.0.0.1", MockHistoryServer::query(from, to), port, pool).read(analyzer)
+                    && analyzer.size() == 20;
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        REQUIRE(ok == std::vector<int>(4, 1));
+        REQUIRE(elapsed >= options.latency);
+        REQUIRE(server.peakConcurrency() > 1);
+    }
+
+    SECTION("HTTP request fails with invalid URI")
+    {
+        HistorySourceHTTP source("http://beep.boop", "queery");
+        REQUIRE_FALSE(static_cast<bool>(source.get()));
+
+        HistorySourceHTTP source2("apo.beep.boop", "queery");
+        REQUIRE_FALSE(static_cast<bool>(source2.get()));
+    }
+
+    pool.clear();
+}
+
+// HTTPConnectionPool tests
+TEST_CASE("HTTP connections are pooled")
+{
+    httplib::Server server;
+    server.Get("/ping", [](const httplib::Request&, httplib::Response& res)
+    {
+        res.set_content("pong", "text/plain");
+    });
+
+    auto port = server.bind_to_any_port("127.0.0.1");
+    REQUIRE(port > 0);
+    auto thread = startServer(server);
+
+    HTTPConnectionPool pool;
+
+    SECTION("Sequential requests share a connection")
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            auto res = pool.get("127.0.0.1", port, "/ping");
+            REQUIRE(res);
+            REQUIRE(res->status == 200);
+            REQUIRE(res->body == "pong");
+        }
+        REQUIRE(pool.connectionsOpened() == 1);
+    }
+
+    SECTION("Connections the server closes are replaced")
+    {
+        server.set_keep_alive_max_count(2);
+        for (int i = 0; i < 4; ++i)
+        {
+            REQUIRE(pool.get("127.0.0.1", port, "/ping"));
+        }
+        REQUIRE(pool.connectionsOpened() == 2);
+    }
+
+    SECTION("Concurrent requests get a connection each")
+    {
+        std::vector<std::thread> threads;
+        std::vector<int> ok(4);
+        for (std::size_t t = 0; t < ok.size(); ++t)
+        {
+            threads.emplace_back([&pool, &ok, port, t]
+            {
+                for (int i = 0; i < 3; ++i)
+                {
+                    auto res = pool.get("127.0.0.1", port, "/ping");
+                    ok[t] += res && res->body == "pong";
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        REQUIRE(ok == std::vector<int>(4, 3));
+        REQUIRE(pool.connectionsOpened() <= 4);
+    }
+
+    // Let the server's connection threads finish before stopping it
+    pool.clear();
+    server.stop();
+    thread.join();
+}
+
+TEST_CASE("Server connections are handled by a fixed pool of threads")
+{
+    httplib::Server server;
+    server.set_thread_pool(2, 2);
+
+    std::mutex mutex;
+    std::set<std::thread::id> handlers;
+    server.Get("/ping", [&mutex, &handlers](const httplib::Request&, httplib::Response& res)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            handlers.insert(std::this_thread::get_id());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        res.set_content("pong", "text/plain");
+    });
+
+    auto port = server.bind_to_any_port("127.0.0.1");
+    REQUIRE(port > 0);
+    auto thread = startServer(server);
+
+    SECTION("More connections than threads all get served")
+    {
+        std::vector<std::thread> clients;
+        std::vector<int> ok(12);
+        for (std::size_t c = 0; c < ok.size(); ++c)
+        {
+            clients.emplace_back([&ok, port, c]
+            {
+                httplib::Client client("127.0.0.1", port);
+                auto res = client.Get("/ping");
+                ok[c] = res && res->body == "pong";
+            });
+        }
+        for (auto& c : clients)
+        {
+            c.join();
+        }
+        REQUIRE(ok == std::vector<int>(12, 1));
+        REQUIRE(handlers.size() <= 2);
+    }
+
+    SECTION("Idle kept alive connections give way to waiting ones")
+    {
+        server.set_thread_pool(1, 2);
+        server.stop();
+        thread.join();
+        port = server.bind_to_any_port("127.0.0.1");
+        thread = startServer(server);
+
+        // The pooled connection stays open, holding the only thread
+        HTTPConnectionPool pool;
+        REQUIRE(pool.get("127.0.0.1", port, "/ping"));
+
+        auto start = std::chrono::steady_clock::now();
+        httplib::Client client("127.0.0.1", port);
+        auto res = client.Get("/ping");
+        REQUIRE(res);
+        REQUIRE(res->status == 200);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+
+        // The pool notices its connection was closed and opens another
+        REQUIRE(pool.get("127.0.0.1", port, "/ping"));
+        REQUIRE(pool.connectionsOpened() == 2);
+    }
+
+    server.stop();
+    thread.join();
+}
+
+// HistorySourceHTTPChunked tests
+TEST_CASE("Long ranges are fetched in monthly chunks")
+{
+    std::int64_t from, to;
+    REQUIRE(DateTime::parse("2017-11-15", from));
+    REQUIRE(DateTime::parse("2018-03-02", to));
+
+    SECTION("Ranges split on calendar months")
+    {
+        auto months = HistorySourceHTTPChunked::splitMonths(from, to);
+        REQUIRE(months.size() == 5);
+        REQUIRE(DateTime::format(months[0].first) == "2017-11-15");
+        REQUIRE(DateTime::format(months[0].second) == "2017-11-30");
+        REQUIRE(DateTime::format(months[1].first) == "2017-12-01");
+        REQUIRE(DateTime::format(months[1].second) == "2017-12-31");
+        REQUIRE(DateTime::format(months[3].second) == "2018-02-28");
+        REQUIRE(DateTime::format(months[4].first) == "2018-03-01");
+        REQUIRE(DateTime::format(months[4].second) == "2018-03-02");
+
+        REQUIRE(HistorySourceHTTPChunked::splitMonths(to, to).size() == 1);
+        REQUIRE(HistorySourceHTTPChunked::splitMonths(to, from).empty());
+    }
+
+    SECTION("Chunks merge into one series in date order")
+    {
+        // Serve a price for every day of the requested range
+        MockHistoryServer server;
+        auto port = server.start();
+        REQUIRE(port > 0);
+
+        {
+            HTTPConnectionPool pool;
+            HistorySourceHTTPChunked source("127.0.0.1", MockHistoryServer::Path, from, to, 3, port, pool);
+
+            HistoryAnalyzer analyzer;
+            REQUIRE(source.read(analyzer));
+            REQUIRE(analyzer.size() == static_cast<std::size_t>((to - from) / DateTime::SecondsPerDay + 1));
+            for (std::size_t i = 0; i < analyzer.size(); ++i)
+            {
+                auto p = analyzer.getDataPoint(i);
+                REQUIRE(p.time == from + static_cast<std::int64_t>(i) * DateTime::SecondsPerDay);
+                REQUIRE(p.price == MockHistoryServer::price(p.time, 42));
+            }
+
+            auto json = source.get();
+            REQUIRE(static_cast<bool>(json));
+            REQUIRE((*json)["bpi"].size() == analyzer.size());
+            REQUIRE(server.requests() == 10);
+
+            // Any failed month fails the whole range
+            HistorySourceHTTPChunked missing("127.0.0.1", "/missing.json", from, to, 3, port, pool);
+            REQUIRE_FALSE(missing.read(analyzer));
+        }
+
+        server.stop();
+    }
+}
+
+// HTTPCache tests
+TEST_CASE("HTTP responses are cached on disk")
+{
+    // Count requests, answering conditional ones for the current ETag
+    int requests = 0;
+    int downloads = 0;
+    httplib::Server server;
+    server.Get("/close.json", [&requests, &downloads](const httplib::Request& req, httplib::Response& res)
+    {
+        ++requests;
+        if (req.get_header_value("If-None-Match") == "\"v1\"")
+        {
+            res.status = 304;
+            return;
+        }
+        ++downloads;
+        res.set_header("ETag", "\"v1\"");
+        res.set_content(exampleJson.dump(), "application/json");
+    });
+
+    auto port = server.bind_to_any_port("127.0.0.1");
+    REQUIRE(port > 0);
+    auto thread = startServer(server);
+
+    {
+        HTTPConnectionPool pool;
+        std::string host = "127.0.0.1";
+        std::string open = "/close.json?start=2018-01-01";
+        std::string closed = "/close.json?start=2018-01-01&end=2018-01-20";
+        auto key = [&](const std::string& path) { return host + ":" + std::to_string(port) + path; };
+
+        SECTION("Stale responses are revalidated")
+        {
+            HTTPCache cache("bctest-cache", 0, pool);
+            cache.remove(key(open));
+
+            for (int i = 0; i < 3; ++i)
+            {
+                auto res = cache.get(host, port, open);
+                REQUIRE(res);
+                REQUIRE(res->status == 200);
+                REQUIRE(nlohmann::json::parse(res->body) == exampleJson);
+            }
+            REQUIRE(requests == 3);
+            REQUIRE(downloads == 1);
+            REQUIRE(cache.load(key(open))->etag == "\"v1\"");
+        }
+
+        SECTION("Fresh and closed responses make no request")
+        {
+            HTTPCache cache("bctest-cache", 3600, pool);
+            cache.remove(key(open));
+            REQUIRE(cache.get(host, port, open));
+            REQUIRE(cache.get(host, port, open));
+            REQUIRE(requests == 1);
+
+            HTTPCache expired("bctest-cache", 0, pool);
+            expired.remove(key(closed));
+            REQUIRE(expired.get(host, port, closed));
+            REQUIRE(expired.load(key(closed))->permanent);
+            REQUIRE(expired.get(host, port, closed));
+            REQUIRE(requests == 2);
+
+            // Sources go through the cache too
+            HistorySourceHTTPChunked source(host, "/close.json", 0, 0, 1, port, pool);
+            source.setCache(&expired);
+            expired.remove(key("/close.json?start=1970-01-01&end=1970-01-01"));
+            HistoryAnalyzer analyzer;
+            REQUIRE(source.read(analyzer));
+            REQUIRE(source.read(analyzer));
+            REQUIRE(requests == 3);
+        }
+
+        SECTION("Only ranges ending before today are closed")
+        {
+            std::int64_t now;
+            REQUIRE(DateTime::parse("2018-01-21 12:00", now));
+            REQUIRE(HTTPCache::isClosedRange(closed, now));
+            REQUIRE_FALSE(HTTPCache::isClosedRange(open, now));
+            REQUIRE_FALSE(HTTPCache::isClosedRange("/close.json?start=2018-01-01&end=2018-01-21", now));
+            REQUIRE_FALSE(HTTPCache::isClosedRange("/close.json", now));
+        }
+    }
+
+    server.stop();
+    thread.join();
+}
+
+// HistoryStore tests
+TEST_CASE("Only days missing from the store are fetched")
+{
+    // Serve a price for every day of the requested range, counting them
+    std::vector<std::string> queries;
+    std::mutex mutex;
+    httplib::Server server;
+    server.Get("/close.json", [&queries, &mutex](const httplib::Request& req, httplib::Response& res)
+    {
+        std::int64_t start, end;
+        DateTime::parse(req.get_param_value("start"), start);
+        DateTime::parse(req.get_param_value("end"), end);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queries.push_back(req.get_param_value("start") + " " + req.get_param_value("end"));
+        }
+
+        nlohmann::json json;
+        for (auto time = start; time <= end; time += DateTime::SecondsPerDay)
+        {
+            json["bpi"][DateTime::format(time)] = 10000. + (time / DateTime::SecondsPerDay) % 97;
+        }
+        res.set_content(json.dump(), "application/json");
+    });
+
+    auto port = server.bind_to_any_port("127.0.0.1");
+    REQUIRE(port > 0);
+    auto thread = startServer(server);
+
+    {
+        std::string path = "bctest.store";
+        std::remove(path.c_str());
+
+        std::int64_t from, to, later;
+        REQUIRE(DateTime::parse("2018-01-01", from));
+        REQUIRE(DateTime::parse("2018-01-20", to));
+        REQUIRE(DateTime::parse("2018-01-22", later));
+
+        HistoryAnalyzer analyzer;
+        HistorySourceStore source(path, "127.0.0.1", "/close.json", from, to, port);
+        REQUIRE(source.read(analyzer));
+        REQUIRE(analyzer.size() == 20);
+        REQUIRE(queries == std::vector<std::string>{"2018-01-01 2018-01-20"});
+
+        // Known days are never fetched again
+        REQUIRE(source.read(analyzer));
+        REQUIRE(analyzer.size() == 20);
+        REQUIRE(queries.size() == 1);
+
+        // Moving the range on only fetches the new days, either side
+        std::int64_t earlier;
+        REQUIRE(DateTime::parse("2017-12-30", earlier));
+        HistorySourceStore extended(path, "127.0.0.1", "/close.json", earlier, later, port);
+        REQUIRE(extended.read(analyzer));
+        REQUIRE(analyzer.size() == 24);
+        REQUIRE(queries.size() == 3);
+        // Gaps are fetched together, so in no particular order
+        std::sort(queries.begin() + 1, queries.end());
+        REQUIRE(queries[1] == "2017-12-30 2017-12-31");
+        REQUIRE(queries[2] == "2018-01-21 2018-01-22");
+        REQUIRE(std::is_sorted(analyzer.getTimes().begin(), analyzer.getTimes().end()));
+        REQUIRE(analyzer.getDataPoint(0).price == 10000. + (earlier / DateTime::SecondsPerDay) % 97);
+
+        // The store persists, and reports gaps as runs of days
+        HistoryStore store(path);
+        REQUIRE(store.isOpen());
+        REQUIRE(store.size() == 24);
+        REQUIRE(store.missing(earlier, later).empty());
+
+        std::int64_t beyond;
+        REQUIRE(DateTime::parse("2018-01-25", beyond));
+        auto gaps = store.missing(from, beyond);
+        REQUIRE(gaps.size() == 1);
+        REQUIRE(DateTime::format(gaps[0].first) == "2018-01-23");
+        REQUIRE(DateTime::format(gaps[0].second) == "2018-01-25");
+
+        std::remove(path.c_str());
+    }
+
+    server.stop();
+    thread.join();
+}
+
+TEST_CASE("Days fetched without a price aren't fetched again once settled")
+{
+    // Some days aren't published, from March nothing is, not even a body,
+    // and yesterday's price isn't out yet
+    std::int64_t unpublishedFrom, unpublishedTo, march;
+    REQUIRE(DateTime::parse("2018-02-10", unpublishedFrom));
+    REQUIRE(DateTime::parse("2018-02-12", unpublishedTo));
+    REQUIRE(DateTime::parse("2018-03-01", march));
+
+    auto now = static_cast<std::int64_t>(std::time(nullptr));
+    auto yesterday = now - now % DateTime::SecondsPerDay - DateTime::SecondsPerDay;
+
+    std::vector<std::string> queries;
+    std::mutex mutex;
+    httplib::Server server;
+    server.Get("/close.json", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        std::int64_t start, end;
+        DateTime::parse(req.get_param_value("start"), start);
+        DateTime::parse(req.get_param_value("end"), end);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queries.push_back(req.get_param_value("start") + " " + req.get_param_value("end"));
+        }
+        if (start >= march && end < yesterday - 30 * DateTime::SecondsPerDay)
+        {
+            res.set_content("", "application/json");
+            return;
+        }
+
+        nlohmann::json json;
+        json["bpi"] = nlohmann::json::object();
+        for (auto time = start; time <= end; time += DateTime::SecondsPerDay)
+        {
+            if ((time < unpublishedFrom || time > unpublishedTo) && time != yesterday)
+            {
+                json["bpi"][DateTime::format(time)] = 10000.;
+            }
+        }
+        res.set_content(json.dump(), "application/json");
+    });
+
+    auto port = server.bind_to_any_port("127.0.0.1");
+    REQUIRE(port > 0);
+    auto thread = startServer(server);
+
+    {
+        std::string path = "bctest-empty.store";
+        std::remove(path.c_str());
+
+        std::int64_t from, to;
+        REQUIRE(DateTime::parse("2018-02-01", from));
+        REQUIRE(DateTime::parse("2018-02-20", to));
+
+        HistoryAnalyzer analyzer;
+        HistorySourceStore source(path, "127.0.0.1", "/close.json", from, to, port);
+        REQUIRE(source.read(analyzer));
+        REQUIRE(analyzer.size() == 17);
+        REQUIRE(queries.size() == 1);
+
+        // Unpublished days are known, so nothing is fetched
+        REQUIRE(source.read(analyzer));
+        REQUIRE(analyzer.size() == 17);
+        REQUIRE(queries.size() == 1);
+
+        // An empty response says nothing, so fails and is asked for again
+        std::int64_t marchEnd;
+        REQUIRE(DateTime::parse("2018-03-05", marchEnd));
+        HistorySourceStore empty(path, "127.0.0.1", "/close.json", march, marchEnd, port);
+        REQUIRE_FALSE(empty.read(analyzer));
+        REQUIRE_FALSE(empty.read(analyzer));
+        REQUIRE(queries.size() == 3);
+
+        // A recent day without a price may just not be published yet
+        auto recent = yesterday - 5 * DateTime::SecondsPerDay;
+        HistorySourceStore latest(path, "127.0.0.1", "/close.json", recent, yesterday, port);
+        REQUIRE(latest.read(analyzer));
+        REQUIRE(analyzer.size() == 5);
+        REQUIRE(latest.read(analyzer));
+        REQUIRE(queries.size() == 5);
+        REQUIRE(queries[4] == DateTime::format(yesterday) + " " + DateTime::format(yesterday));
+
+        // Empty days persist, but are never read back as prices
+        HistoryStore store(path);
+        REQUIRE(store.isOpen());
+        REQUIRE(store.size() == 22);
+        REQUIRE(store.missing(from, to).empty());
+        REQUIRE(store.missing(march, marchEnd).size() == 1);
+        REQUIRE(store.missing(recent, yesterday).size() == 1);
+
+        store.read(analyzer, from, to);
+        REQUIRE(analyzer.size() == 17);
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
+        {
+            REQUIRE(analyzer.getDataPoint(i).price == 10000.);
+        }
+
+        // Nothing is appended to a file that isn't a store
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << "boop";
+        }
+        HistoryStore invalid(path);
+        REQUIRE_FALSE(invalid.isOpen());
+        REQUIRE_FALSE(invalid.merge(analyzer, from, to));
+        {
+            std::ifstream file(path, std::ios::binary);
+            std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            REQUIRE(contents == "boop");
+        }
+
+        std::remove(path.c_str());
+    }
+
+    server.stop();
+    thread.join();
+}
+
+// Binary json encodings tests
+TEST_CASE("History is read and written in binary json encodings")
+{
+    HistoryAnalyzer analyzer;
+    REQUIRE(analyzer.parse(exampleJson));
+
+    using Format = HistorySourceFile::Format;
+    for (auto name : {"json", "cbor", "msgpack", "ubjson"})
+    {
+        Format format;
+        REQUIRE(HistorySourceFile::parseFormat(name, format));
+
+        auto path = std::string("bctest.") + name;
+        REQUIRE(HistorySourceFile::formatFromPath(path) == format);
+        REQUIRE(HistorySourceFile::write(path, analyzer, format));
+
+        for (auto mode : {HistorySourceFile::Mode::Stream, HistorySourceFile::Mode::MemoryMap})
+        {
+            HistorySourceFile source(path, mode, format);
+            auto json = source.get();
+            REQUIRE(static_cast<bool>(json));
+            REQUIRE((*json)["bpi"] == exampleJson["bpi"]);
+
+            HistoryAnalyzer loaded;
+            REQUIRE(source.read(loaded));
+            REQUIRE(loaded.getTimes() == analyzer.getTimes());
+            REQUIRE(loaded.getPrices() == analyzer.getPrices());
+        }
+
+        // Decoding as the wrong encoding fails cleanly
+        if (format != Format::JSON)
+        {
+            HistorySourceFile wrong(path, HistorySourceFile::Mode::Stream,
+                format == Format::CBOR ? Format::UBJSON : Format::CBOR);
+            HistoryAnalyzer loaded;
+            REQUIRE_FALSE(wrong.read(loaded));
+        }
+
+        std::remove(path.c_str());
+    }
+
+    Format format;
+    REQUIRE_FALSE(HistorySourceFile::parseFormat("boop", format));
+    REQUIRE(HistorySourceFile::formatFromPath("history") == Format::JSON);
+}
+
+// HistorySourceBinary tests
+TEST_CASE("Binary history files round trip")
+{
+    std::string path = "bctest.bin";
+
+    auto roundTrip = [&path](const HistoryAnalyzer& analyzer, bool delta)
+    {
+        REQUIRE(HistorySourceBinary::write(path, analyzer, delta));
+        REQUIRE(HistorySourceBinary::isBinary(path));
+
+        HistorySourceBinary source(path);
+        REQUIRE(source.isOpen());
+        REQUIRE(source.header().count == analyzer.size());
+        REQUIRE(reinterpret_cast<std::uintptr_t>(source.prices()) % 64 == 0);
+
+        HistoryAnalyzer loaded;
+        REQUIRE(source.read(loaded));
+        REQUIRE(loaded.size() == analyzer.size());
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
+        {
+            REQUIRE(loaded.getDataPoint(i).time == analyzer.getDataPoint(i).time);
+            REQUIRE(loaded.getDataPoint(i).price == analyzer.getDataPoint(i).price);
+        }
+        return source.header().unit;
+    };
+
+    SECTION("Daily data is keyed by day")
+    {
+        HistoryAnalyzer analyzer;
+        REQUIRE(analyzer.parse(exampleJson));
+        REQUIRE(roundTrip(analyzer, false) == DateTime::SecondsPerDay);
+        REQUIRE(roundTrip(analyzer, true) == DateTime::SecondsPerDay);
+
+        HistorySourceBinary source(path);
+        REQUIRE(source.keys()[0] == 0);
+        REQUIRE(source.keys()[5] == 1);
+        REQUIRE(*source.get() == nlohmann::json({{"bpi", exampleJson["bpi"]}}));
+    }
+
+    SECTION("Intraday data is keyed by the coarsest whole unit")
+    {
+        HistoryAnalyzer minutes;
+        std::int64_t time = 1514764800;
+        for (std::int64_t i = 0; i < 1000; ++i)
+        {
+            time += 60 * (1 + i % 3);
+            REQUIRE(minutes.append(time, 10000. + i));
+        }
+        REQUIRE(roundTrip(minutes, false) == 60);
+        REQUIRE(roundTrip(minutes, true) == 60);
+
+        HistoryAnalyzer seconds;
+        REQUIRE(seconds.append(std::int64_t(1514764800), 1.));
+        REQUIRE(seconds.append(std::int64_t(1514764801), 2.));
+        REQUIRE(roundTrip(seconds, false) == 1);
+
+        HistoryAnalyzer empty;
+        roundTrip(empty, false);
+    }
+
+    SECTION("Invalid files are rejected")
+    {
+        HistoryAnalyzer analyzer;
+        REQUIRE(analyzer.parse(exampleJson));
+        REQUIRE(HistorySourceBinary::write(path, analyzer));
+
+        // Cut off part of the price column
+        std::string bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(bytes.data(), bytes.size() - 8);
+        }
+        HistorySourceBinary truncated(path);
+        REQUIRE_FALSE(truncated.isOpen());
+        REQUIRE_FALSE(truncated.read(analyzer));
+
+        // Units that aren't a day, hour, minute or second, and base times
+        // that keys could overflow from
+        auto rewrite = [&path, &bytes](std::size_t offset, std::int64_t value)
+        {
+            auto changed = bytes;
+            std::memcpy(&changed[offset], &value, sizeof(value));
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(changed.data(), changed.size());
+        };
+        for (std::int64_t unit : {std::int64_t(0), std::int64_t(-1), std::int64_t(7),
+            std::numeric_limits<std::int64_t>::max()})
+        {
+            rewrite(offsetof(HistorySourceBinary::Header, unit), unit);
+            REQUIRE_FALSE(HistorySourceBinary(path).isOpen());
+        }
+        for (auto baseTime : {std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min()})
+        {
+            rewrite(offsetof(HistorySourceBinary::Header, baseTime), baseTime);
+            REQUIRE_FALSE(HistorySourceBinary(path).isOpen());
+        }
+
+        // Delta keys that sum past what a key can hold
+        REQUIRE(HistorySourceBinary::write(path, analyzer, true));
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            std::int32_t keys[2] = {std::numeric_limits<std::int32_t>::max(), std::numeric_limits<std::int32_t>::max()};
+            file.seekp(sizeof(HistorySourceBinary::Header));
+            file.write(reinterpret_cast<const char*>(keys), sizeof(keys));
+        }
+        HistorySourceBinary corrupt(path);
+        REQUIRE(corrupt.isOpen());
+        REQUIRE_FALSE(corrupt.read(analyzer));
+
+        // Prices that aren't numbers
+        for (auto price : {std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+            -std::numeric_limits<double>::infinity()})
+        {
+            REQUIRE(HistorySourceBinary::write(path, analyzer));
+            std::uint64_t pricesOffset = HistorySourceBinary(path).header().pricesOffset;
+            {
+                std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+                file.seekp(static_cast<std::streamoff>(pricesOffset + 5 * sizeof(double)));
+                file.write(reinterpret_cast<const char*>(&price), sizeof(price));
+            }
+            HistorySourceBinary unpriced(path);
+            REQUIRE(unpriced.isOpen());
+            HistoryAnalyzer loaded;
+            REQUIRE_FALSE(unpriced.read(loaded));
+            REQUIRE(loaded.size() == 0);
+        }
+
+        HistorySourceBinary missing("boop.bin");
+        REQUIRE_FALSE(missing.isOpen());
+        REQUIRE_FALSE(HistorySourceBinary::isBinary("boop.bin"));
+    }
+
+    std::remove(path.c_str());
+}
+
+// CompressedSeries tests
+TEST_CASE("Compressed series round trip and analyze in blocks")
+{
+    auto roundTrip = [](const HistoryAnalyzer& analyzer)
+    {
+        CompressedSeries series(analyzer);
+        REQUIRE(series.size() == analyzer.size());
+
+        HistoryAnalyzer decompressed;
+        series.decompress(decompressed);
+        REQUIRE(decompressed.size() == analyzer.size());
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
+        {
+            REQUIRE(decompressed.getDataPoint(i).time == analyzer.getDataPoint(i).time);
+            REQUIRE(decompressed.getDataPoint(i).price == analyzer.getDataPoint(i).price);
+        }
+        return series;
+    };
+
+    auto requireSameStats = [](const HistoryAnalyzer::Stats& stats, const HistoryAnalyzer::Stats& expected)
+    {
+        REQUIRE(stats.dataSize == expected.dataSize);
+        REQUIRE(stats.highest.time == expected.highest.time);
+        REQUIRE(stats.highest.price == expected.highest.price);
+        REQUIRE(stats.lowest.time == expected.lowest.time);
+        REQUIRE(stats.lowest.price == expected.lowest.price);
+        REQUIRE(stats.meanPrice == Approx(expected.meanPrice));
+        REQUIRE(stats.medianPrice == expected.medianPrice);
+        REQUIRE(stats.standardDeviation == Approx(expected.standardDeviation));
+    };
+
+    SECTION("Daily data")
+    {
+        HistoryAnalyzer analyzer;
+        REQUIRE(analyzer.parse(exampleJson));
+        auto series = roundTrip(analyzer);
+        REQUIRE(series.blockCount() == 1);
+        requireSameStats(series.analyze(), analyzer.analyze());
     }
-}
\ No newline at end of file
+
+    SECTION("Irregular intraday data across many blocks")
+    {
+        HistoryAnalyzer analyzer;
+        std::int64_t time = 1514764800;
+        double price = 10000.;
+        for (std::int64_t i = 0; i < 5000; ++i)
+        {
+            // Mostly regular, with repeats, small jitter and the odd big gap
+            time += i % 500 == 0 ? 86400 * 40 : 60 + (i % 7 == 0 ? i % 13 : 0);
+            if (i % 3 != 0)
+            {
+                price = std::round((price + ((i * 7919) % 101 - 50) * 0.37) * 10000.) / 10000.;
+            }
+            REQUIRE(analyzer.append(time, i == 2500 ? -price : price));
+        }
+        auto series = roundTrip(analyzer);
+        REQUIRE(series.blockCount() == (5000 + CompressedSeries::BlockSize - 1) / CompressedSeries::BlockSize);
+        REQUIRE(series.memoryUsage() < analyzer.size() * (sizeof(std::int64_t) + sizeof(double)));
+        requireSameStats(series.analyze(), analyzer.analyze());
+
+        REQUIRE(series.getDataPoint(2500).price == analyzer.getDataPoint(2500).price);
+        REQUIRE(series.getDataPoint(4999).time == analyzer.getDataPoint(4999).time);
+
+        // Ranges within a block, across blocks, across a gap and outside it all
+        HistoryIndex index(analyzer);
+        auto& times = analyzer.getTimes();
+        std::vector<std::pair<std::int64_t, std::int64_t>> ranges = {
+            {times[10], times[20]}, {times[1000] + 1, times[3100]}, {times[499], times[501]},
+            {times[0] - 1000, times[4999] + 1000}, {times[4999], times[4999]}};
+        for (auto& range : ranges)
+        {
+            auto stats = series.analyze(range.first, range.second);
+            auto expected = analyzer.analyze(range.first, range.second);
+            REQUIRE(static_cast<bool>(stats));
+            REQUIRE(static_cast<bool>(expected));
+            requireSameStats(*stats, *expected);
+
+            for (auto q : {0., 0.1, 0.5, 0.75, 1.})
+            {
+                REQUIRE(*series.quantile(range.first, range.second, q) == *index.quantile(range.first, range.second, q));
+            }
+        }
+        REQUIRE_FALSE(series.analyze(times[4999] + 1, times[4999] + 1000));
+        REQUIRE_FALSE(series.analyze(times[20] + 1, times[21] - 1));
+        REQUIRE_FALSE(series.quantile(0, times[0] - 1, 0.5));
+    }
+
+    SECTION("Extreme values and appends")
+    {
+        CompressedSeries series;
+        REQUIRE(series.analyze().dataSize == 0);
+
+        std::vector<std::pair<std::int64_t, double>> points = {
+            {0, 0.}, {1, -0.}, {2, 1e300}, {std::int64_t(1) << 40, -1e-300}, {(std::int64_t(1) << 40) + 1, 1.},
+            {(std::int64_t(1) << 40) + 2, 1.}, {(std::int64_t(1) << 41), std::numeric_limits<double>::infinity()}};
+        for (auto& point : points)
+        {
+            REQUIRE(series.append(point.first, point.second));
+        }
+
+        // Same as the analyzer, times must increase
+        REQUIRE_FALSE(series.append(5, 1.));
+        REQUIRE_FALSE(series.append(std::int64_t(1) << 41, 1.));
+
+        HistoryAnalyzer decompressed;
+        series.decompress(decompressed);
+        REQUIRE(decompressed.size() == points.size());
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            REQUIRE(decompressed.getDataPoint(i).time == points[i].first);
+            REQUIRE(std::signbit(decompressed.getDataPoint(i).price) == std::signbit(points[i].second));
+            REQUIRE(decompressed.getDataPoint(i).price == points[i].second);
+        }
+    }
+}
+
+// BatchAnalyzer tests
+TEST_CASE("Many files are analyzed together")
+{
+    // Histories of different lengths, so results can't be mixed up
+    std::vector<std::string> paths = {"bcbatch-1.json", "bcbatch-2.json", "bcbatch-3.json"};
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        auto json = exampleJson;
+        for (std::size_t day = 0; day < i; ++day)
+        {
+            json["bpi"].erase(json["bpi"].begin());
+        }
+        std::ofstream(paths[i], std::ios::trunc) << json;
+    }
+
+    HistoryAnalyzer example;
+    REQUIRE(example.parse(exampleJson));
+    REQUIRE(HistorySourceBinary::write("bcbatch-4.bin", example));
+    std::ofstream("bcbatch-5.json", std::ios::trunc) << "{\"bpi\":{\"2018-01-01\":";
+
+    SECTION("Wildcards expand to sorted files")
+    {
+        auto expanded = BatchAnalyzer::expand({"bcbatch-*", "./bcbatch-?.json", "missing.json"});
+        REQUIRE(expanded == std::vector<std::string>({"bcbatch-1.json", "bcbatch-2.json", "bcbatch-3.json",
+            "bcbatch-4.bin", "bcbatch-5.json", "./bcbatch-1.json", "./bcbatch-2.json", "./bcbatch-3.json",
+            "./bcbatch-5.json", "missing.json"}));
+        REQUIRE(BatchAnalyzer::expand({"bcbatch-*.none"}).empty());
+    }
+
+    SECTION("Results match analyzing each file alone")
+    {
+        auto expanded = BatchAnalyzer::expand({"bcbatch-*", "missing.json"});
+        auto results = BatchAnalyzer(3).run(expanded);
+        REQUIRE(results.size() == expanded.size());
+
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            HistoryAnalyzer alone;
+            auto read = i < 3 ? HistorySourceFile(expanded[i]).read(alone) : HistorySourceBinary(expanded[i]).read(alone);
+            REQUIRE(read);
+
+            REQUIRE(results[i].path == expanded[i]);
+            REQUIRE(results[i].ok);
+            REQUIRE(results[i].stats.dataSize == alone.size());
+            REQUIRE(results[i].stats.medianPrice == alone.analyze().medianPrice);
+            REQUIRE(results[i].stats.highest.time == alone.analyze().highest.time);
+        }
+
+        // Broken and missing files fail on their own
+        REQUIRE_FALSE(results[4].ok);
+        REQUIRE_FALSE(results[5].ok);
+    }
+
+    SECTION("Ranges apply to every file")
+    {
+        std::int64_t from, to;
+        REQUIRE(DateTime::parse("2018-01-02", from));
+        REQUIRE(DateTime::parse("2018-01-04", to));
+
+        BatchAnalyzer batch(2);
+        batch.setRange(from, to);
+        auto results = batch.run({"bcbatch-1.json", "bcbatch-3.json"});
+        REQUIRE(results[0].ok);
+        REQUIRE(results[0].stats.dataSize == 3);
+        REQUIRE(results[1].ok);
+        REQUIRE(results[1].stats.dataSize == 2);
+        REQUIRE(results[1].stats.highest.price == 15155.2263);
+    }
+
+    for (auto& path : paths)
+    {
+        std::remove(path.c_str());
+    }
+    std::remove("bcbatch-4.bin");
+    std::remove("bcbatch-5.json");
+}
+
+// HistorySourceFile tests
+TEST_CASE("Get history from file")
+{   
+    // Dump the example json into a file for test purposes
+    const std::string testFilePath("test.json");
+    std::ofstream testFile(testFilePath, std::ios::trunc);
+    testFile << exampleJson;
+    testFile.close();
+
+    SECTION("Valid file loads correctly")
+    {
+        HistorySourceFile source(testFilePath);
+        auto data = source.get();
+        REQUIRE(static_cast<bool>(data));
+        REQUIRE(*data == exampleJson);
+    }
+
+    SECTION("Valid file reads into analyzer")
+    {
+        HistorySourceFile source(testFilePath);
+        HistoryAnalyzer analyzer;
+        REQUIRE(source.read(analyzer));
+        REQUIRE(analyzer.analyze().dataSize == 20);
+    }
+
+    SECTION("Memory mapped file loads correctly")
+    {
+        HistorySourceFile source(testFilePath, HistorySourceFile::Mode::MemoryMap);
+        auto data = source.get();
+        REQUIRE(static_cast<bool>(data));
+        REQUIRE(*data == exampleJson);
+
+        HistoryAnalyzer analyzer;
+        REQUIRE(source.read(analyzer));
+        REQUIRE(analyzer.analyze().dataSize == 20);
+    }
+
+    SECTION("Invalid file fails cleanly")
+    {
+        HistorySourceFile source("boop");
+        REQUIRE_FALSE(static_cast<bool>(source.get()));
+
+        HistoryAnalyzer analyzer;
+        REQUIRE_FALSE(source.read(analyzer));
+
+        HistorySourceFile mapped("boop", HistorySourceFile::Mode::MemoryMap);
+        REQUIRE_FALSE(static_cast<bool>(mapped.get()));
+        REQUIRE_FALSE(mapped.read(analyzer));
+    }
+    SECTION("Invalid json fails cleanly")
+    {
+        testFile.open(testFilePath);
+        testFile << "boop";
+        testFile.close();
+
+        HistorySourceFile source(testFilePath);
+        REQUIRE_FALSE(static_cast<bool>(source.get()));
+    }
+}
+// OutputWriter tests
+TEST_CASE("Output is written in each format")
+{
+    // Enough points to fill the buffer several times over, with prices that
+    // need all seventeen digits to read back
+    HistoryAnalyzer analyzer;
+    for (std::int64_t i = 0; i < 10000; ++i)
+    {
+        REQUIRE(analyzer.append(1514764800 + i * 60, 10000. / 3. + i * 0.1));
+    }
+    auto stats = analyzer.analyze();
+
+    auto write = [&analyzer, &stats](OutputWriter::Format format)
+    {
+        std::ostringstream out;
+        OutputWriter writer(out, format);
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
+        {
+            writer.point(analyzer.getDataPoint(i));
+        }
+        writer.stats(stats);
+        writer.finish();
+        return out.str();
+    };
+
+    SECTION("Text is written as iostreams would")
+    {
+        std::ostringstream expected;
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
+        {
+            auto p = analyzer.getDataPoint(i);
+            expected << DateTime::format(p.time) << ": " << p.price << "\n";
+        }
+        expected << "Stats for data:\nTotal samples: " << stats.dataSize << "\n";
+        REQUIRE(write(OutputWriter::Format::Text).find(expected.str()) == 0);
+    }
+
+    SECTION("JSON prices read back exactly")
+    {
+        auto json = nlohmann::json::parse(write(OutputWriter::Format::JSON));
+        REQUIRE(json["points"].size() == analyzer.size());
+        for (std::size_t i = 0; i < analyzer.size(); ++i)
+        {
+            auto p = analyzer.getDataPoint(i);
+            REQUIRE(json["points"][i]["time"] == DateTime::format(p.time));
+            REQUIRE(json["points"][i]["price"].get<double>() == p.price);
+        }
+        REQUIRE(json["stats"]["samples"] == stats.dataSize);
+        REQUIRE(json["stats"]["mean"].get<double>() == stats.meanPrice);
+        REQUIRE(json["stats"]["standardDeviation"].get<double>() == stats.standardDeviation);
+        REQUIRE(json["stats"]["highest"]["time"] == DateTime::format(stats.highest.time));
+    }
+
+    SECTION("CSV and NDJSON have a line per record")
+    {
+        std::istringstream csv(write(OutputWriter::Format::CSV));
+        std::string line;
+        REQUIRE(std::getline(csv, line));
+        REQUIRE(line == "time,price");
+        std::size_t rows = 0;
+        while (std::getline(csv, line) && !line.empty())
+        {
+            auto p = analyzer.getDataPoint(rows++);
+            REQUIRE(line.substr(0, line.find(',')) == DateTime::format(p.time));
+            REQUIRE(std::stod(line.substr(line.find(',') + 1)) == p.price);
+        }
+        REQUIRE(rows == analyzer.size());
+        REQUIRE(std::getline(csv, line));
+        REQUIRE(line.find("samples,") == 0);
+
+        std::istringstream ndjson(write(OutputWriter::Format::NDJSON));
+        rows = 0;
+        while (std::getline(ndjson, line))
+        {
+            auto json = nlohmann::json::parse(line);
+            REQUIRE(json.count(rows < analyzer.size() ? "price" : "median") == 1);
+            ++rows;
+        }
+        REQUIRE(rows == analyzer.size() + 1);
+    }
+
+    SECTION("Batch files are quoted and failures marked")
+    {
+        std::ostringstream csv, json;
+        {
+            OutputWriter csvWriter(csv, OutputWriter::Format::CSV);
+            csvWriter.file("a,\"b\".json", &stats);
+            csvWriter.file("c.json", nullptr);
+
+            OutputWriter jsonWriter(json, OutputWriter::Format::JSON);
+            jsonWriter.file("a,\"b\".json", &stats);
+            jsonWriter.file("c.json", nullptr);
+        }
+        REQUIRE(csv.str().find("\n\"a,\"\"b\"\".json\",10000,") != std::string::npos);
+        REQUIRE(csv.str().find("\nc.json,,,,,,,,\n") != std::string::npos);
+
+        auto files = nlohmann::json::parse(json.str())["files"];
+        REQUIRE(files.size() == 2);
+        REQUIRE(files[0]["path"] == "a,\"b\".json");
+        REQUIRE(files[0]["samples"] == 10000);
+        REQUIRE(files[1]["error"] == "failed");
+    }
+
+    OutputWriter::Format format;
+    REQUIRE(OutputWriter::parseFormat("ndjson", format));
+    REQUIRE(format == OutputWriter::Format::NDJSON);
+    REQUIRE_FALSE(OutputWriter::parseFormat("xml", format));
+}
+
+// StatsCache tests
+TEST_CASE("Stats are cached until the data changes")
+{
+    HistoryAnalyzer analyzer;
+    REQUIRE(analyzer.parse(exampleJson));
+    HistoryIndex index(analyzer);
+
+    StatsCache cache(2);
+    auto computed = 0;
+    auto query = [&](std::int64_t from, std::int64_t to)
+    {
+        return cache.get({"test", from, to}, analyzer.generation(), [&]
+        {
+            ++computed;
+            return index.query(from, to);
+        });
+    };
+
+    auto stats = query(1514764800, 1515196799);
+    REQUIRE(static_cast<bool>(stats));
+    REQUIRE(stats->dataSize == 5);
+    REQUIRE(query(1514764800, 1515196799)->dataSize == 5);
+    REQUIRE(computed == 1);
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 1);
+
+    // Sources are told apart
+    REQUIRE_FALSE(static_cast<bool>(cache.find({"other", 1514764800, 1515196799}, analyzer.generation())));
+
+    // The least recently used range makes way
+    query(1514764800, 1514851199);
+    query(1514764800, 1515196799);
+    query(1515196800, 1516406399);
+    REQUIRE(cache.size() == 2);
+    REQUIRE(computed == 3);
+    query(1514764800, 1515196799);
+    REQUIRE(computed == 3);
+    query(1514764800, 1514851199);
+    REQUIRE(computed == 4);
+
+    // Empty ranges aren't cached
+    REQUIRE_FALSE(static_cast<bool>(query(0, 1)));
+    REQUIRE_FALSE(static_cast<bool>(query(0, 1)));
+    REQUIRE(computed == 6);
+
+    // Appending changes the generation, so the entry is stale
+    auto generation = analyzer.generation();
+    REQUIRE(analyzer.append(std::int64_t(1516492800), 1.));
+    REQUIRE(analyzer.generation() != generation);
+    REQUIRE_FALSE(static_cast<bool>(cache.find({"test", 1514764800, 1514851199}, analyzer.generation())));
+    REQUIRE(cache.size() == 1);
+
+    // Different analyzers never share a generation
+    HistoryAnalyzer other;
+    REQUIRE(other.parse(exampleJson));
+    REQUIRE(other.generation() != analyzer.generation());
+
+    StatsCache disabled(0);
+    disabled.insert({"test", 0, 1}, 1, *stats);
+    REQUIRE(disabled.size() == 0);
+}
+
+// StatsServer tests
+TEST_CASE("Stats are served over HTTP")
+{
+    const std::string path("bcserve.json");
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << exampleJson;
+    }
+
+    StatsServer server(std::make_unique<HistorySourceFile>(path));
+    server.setRefreshInterval(3600);
+    REQUIRE(server.load());
+
+    auto port = server.bind("localhost", 0);
+    REQUIRE(port > 0);
+    std::thread thread([&server] { server.run(); });
+    while (!server.isRunning())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    httplib::Client client("localhost", port);
+    auto get = [&client](const std::string& path, int status)
+    {
+        auto response = client.Get(path.c_str());
+        REQUIRE(response);
+        REQUIRE(response->status == status);
+        return nlohmann::json::parse(response->body);
+    };
+
+    HistoryAnalyzer analyzer;
+    REQUIRE(analyzer.parse(exampleJson));
+    HistoryIndex index(analyzer);
+
+    SECTION("Stats for everything and for ranges")
+    {
+        auto stats = get("/stats", 200);
+        REQUIRE(stats["samples"] == 20);
+        REQUIRE(stats["highest"]["time"] == "2018-01-06");
+        REQUIRE(stats["highest"]["price"] == 17135.8363);
+        REQUIRE(stats["median"].get<double>() == analyzer.analyze().medianPrice);
+
+        stats = get("/stats?from=2018-01-05&to=2018-01-10", 200);
+        auto expected = *index.query(1515110400, 1515628799);
+        REQUIRE(stats["samples"] == 6);
+        REQUIRE(stats["mean"].get<double>() == expected.meanPrice);
+        REQUIRE(stats["lowest"]["time"] == DateTime::format(expected.lowest.time));
+
+        REQUIRE(get("/stats?from=2018-01-18", 200)["samples"] == 3);
+        REQUIRE(get("/quantile?q=0.5", 200)["price"].get<double>() == analyzer.analyze().medianPrice);
+        REQUIRE(get("/status", 200)["to"] == "2018-01-20");
+
+        // Repeated ranges come from the cache
+        get("/stats?from=2018-01-05&to=2018-01-10", 200);
+        REQUIRE(server.cache().hits() == 1);
+        REQUIRE(get("/status", 200)["cache"]["size"] == 3);
+    }
+
+    SECTION("Compressed history serves the same stats")
+    {
+        server.setCompressed(true);
+        REQUIRE(server.load());
+
+        auto stats = get("/stats?from=2018-01-05&to=2018-01-10", 200);
+        auto expected = *index.query(1515110400, 1515628799);
+        REQUIRE(stats["samples"] == 6);
+        REQUIRE(stats["mean"].get<double>() == Approx(expected.meanPrice));
+        REQUIRE(stats["median"].get<double>() == expected.medianPrice);
+        REQUIRE(stats["lowest"]["time"] == DateTime::format(expected.lowest.time));
+        REQUIRE(stats["highest"]["time"] == DateTime::format(expected.highest.time));
+
+        REQUIRE(get("/stats", 200)["median"].get<double>() == analyzer.analyze().medianPrice);
+        REQUIRE(get("/quantile?q=0.25&from=2018-01-05", 200)["price"].get<double>()
+            == *index.quantile(1515110400, 1516406400, 0.25));
+        REQUIRE(get("/stats?from=2019-01-01&to=2019-02-01", 404).count("error"));
+
+        auto status = get("/status", 200);
+        REQUIRE(status["samples"] == 20);
+        REQUIRE(status["from"] == "2018-01-01");
+        REQUIRE(status["to"] == "2018-01-20");
+    }
+
+    SECTION("Bad requests")
+    {
+        REQUIRE(get("/stats?from=boop", 400).count("error"));
+        REQUIRE(get("/stats?from=2019-01-01&to=2019-02-01", 404).count("error"));
+        REQUIRE(get("/quantile?q=2", 400).count("error"));
+        REQUIRE(get("/quantile", 400).count("error"));
+    }
+
+    SECTION("Reloads swap in new data")
+    {
+        auto json = exampleJson;
+        json["bpi"]["2018-01-21"] = 1.;
+        {
+            std::ofstream file(path, std::ios::trunc);
+            file << json;
+        }
+        REQUIRE(server.load());
+        REQUIRE(server.loadCount() == 2);
+        REQUIRE(get("/stats", 200)["lowest"]["price"] == 1.);
+
+        // A failed reload keeps serving the last good data
+        std::remove(path.c_str());
+        REQUIRE_FALSE(server.load());
+        REQUIRE(get("/status", 200)["samples"] == 21);
+    }
+
+    // Stopping doesn't wait for the next refresh
+    server.stop();
+    thread.join();
+    std::remove(path.c_str());
+}